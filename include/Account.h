@@ -1,6 +1,6 @@
 #ifndef BOOKSTORE_2025_ACCOUNT_H
 #define BOOKSTORE_2025_ACCOUNT_H
-#include "Storage.h"
+#include "Index.h"
 #include "MemoryRiver.h"
 #include <string>
 struct Account {
@@ -22,7 +22,7 @@ struct Account {
 
 class AccountSystem{
 private:
-    BlockList<31, int> accountIndex; // 用户信息存储:UserID->accountStorage里的位置
+    HashIndex<31, long long> accountIndex; // 用户信息存储:UserID->accountStorage里的位置（只做精确查找）
     MemoryRiver<Account> accountStorage;  // 账户数据存储
 
     // 登录栈
@@ -34,6 +34,7 @@ private:
     std::vector<LoginRecord> loginStack;
 
     void init_root();
+    void migrate_account_index();
     bool ID_pw_check(const std::string& s) const;
     static bool name_check(const std::string& name);
     bool priv_check(int priv) const;
@@ -82,5 +83,8 @@ public:
     // 如果待删除帐户不存在/已登录则操作失败
     // {7}
     void deleteAccount(const string& UserID);
+
+    // 每条指令后调用：增量压缩账户数据文件
+    void vacuum();
 };
 #endif //BOOKSTORE_2025_ACCOUNT_H
\ No newline at end of file
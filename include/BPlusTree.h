@@ -0,0 +1,620 @@
+#ifndef BOOKSTORE_2025_BPLUSTREE_H
+#define BOOKSTORE_2025_BPLUSTREE_H
+#include "Storage.h"
+
+const int BPT_PAGE_SIZE = 4096;     // B+树页面大小
+
+// 基于磁盘页面的B+树，接口与BlockList一致
+// 条目按(index, value)排序；页面经共享缓冲池读写，页号即缓冲池中的offset
+// 删除时不做节点合并，叶子可以变空但仍留在叶子链表中
+// 所有页面（包括树头）经预写日志提交，淘汰或检查点时才写回原位
+template<int INDEX_LEN, typename TypeName>
+class BPlusTree : public PageOwner, public JournalClient {
+private:
+    typedef KeyValue<INDEX_LEN, TypeName> Pair;
+
+    // 树头（第0页）
+    struct TreeHeader {
+        int root;             // 根节点页号
+        int first_leaf;       // 最左叶子页号
+        int page_count;       // 已分配页数
+        int height;           // 树高（只有根叶子时为1）
+    };
+
+    // 节点头
+    struct NodeHeader {
+        int is_leaf;          // 是否为叶子
+        int count;            // 叶子中的条目数 / 内部节点中的分隔键数
+        int next_leaf;        // 右侧叶子页号（仅叶子）
+        int padding;
+    };
+
+    // 各留一个位置，用于插入后、分裂前的暂时溢出
+    static const int LEAF_CAP = (BPT_PAGE_SIZE - (int)sizeof(NodeHeader)) / (int)sizeof(Pair) - 1;
+    static const int INNER_CAP = (BPT_PAGE_SIZE - (int)sizeof(NodeHeader) - (int)sizeof(int))
+                                 / ((int)sizeof(Pair) + (int)sizeof(int)) - 1;
+
+    struct LeafNode {
+        NodeHeader header;
+        Pair pairs[LEAF_CAP + 1];
+    };
+
+    // children[i]中的条目不小于keys[i - 1]且小于keys[i]
+    struct InnerNode {
+        NodeHeader header;
+        Pair keys[INNER_CAP + 1];
+        int children[INNER_CAP + 2];
+    };
+
+    static_assert(LEAF_CAP >= 2 && INNER_CAP >= 2, "BPT_PAGE_SIZE too small for this key");
+    static_assert(sizeof(LeafNode) <= BPT_PAGE_SIZE && sizeof(InnerNode) <= BPT_PAGE_SIZE,
+                  "B+ tree node does not fit in a page");
+
+    PositionalFile data_file;     // 数据文件
+    string filename;              // 文件名
+    BufferPool* pool = &BufferPool::shared();  // 页面缓冲池
+    Journal* journal = &Journal::shared();     // 预写日志
+    TreeHeader tree_header;       // 树头缓存
+
+    // 取得并固定页面
+    char* pin_page(int page, bool load = true) {
+        return pool->pin(this, page, BPT_PAGE_SIZE, load);
+    }
+
+    void unpin_page(int page, bool dirty) {
+        pool->unpin(this, page, dirty);
+    }
+
+    // 写回树头
+    void write_tree_header() {
+        char* page = pin_page(0);
+        memcpy(page, &tree_header, sizeof(TreeHeader));
+        unpin_page(0, true);
+    }
+
+    // 分配一个新页面并初始化为空节点
+    int allocate_page(bool is_leaf) {
+        int page = tree_header.page_count++;
+        write_tree_header();
+
+        char* data = pin_page(page, false);
+        memset(data, 0, BPT_PAGE_SIZE);
+        NodeHeader* header = reinterpret_cast<NodeHeader*>(data);
+        header->is_leaf = is_leaf ? 1 : 0;
+        header->next_leaf = -1;
+        unpin_page(page, true);
+        return page;
+    }
+
+    // 比较条目与(index, value)
+    static int compare(const Pair& pair, const char* index, const TypeName& value) {
+        int cmp = strcmp(pair.index, index);
+        if (cmp != 0) return cmp;
+        if (pair.value < value) return -1;
+        if (pair.value > value) return 1;
+        return 0;
+    }
+
+    // 内部节点中(index, value)所在的子节点下标
+    static int child_for(const InnerNode& node, const char* index, const TypeName& value) {
+        int left = 0, right = node.header.count;
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            if (compare(node.keys[mid], index, value) <= 0) {
+                left = mid + 1;
+            }
+            else {
+                right = mid;
+            }
+        }
+        return left;
+    }
+
+    // 内部节点中可能含有index的第一个子节点下标
+    static int first_child_for(const InnerNode& node, const char* index) {
+        int left = 0, right = node.header.count;
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            if (strcmp(node.keys[mid].index, index) < 0) {
+                left = mid + 1;
+            }
+            else {
+                right = mid;
+            }
+        }
+        return left;
+    }
+
+    // 叶子中第一个不小于(index, value)的位置
+    static int leaf_lower_bound(const LeafNode& leaf, const char* index, const TypeName& value) {
+        int left = 0, right = leaf.header.count;
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            if (compare(leaf.pairs[mid], index, value) < 0) {
+                left = mid + 1;
+            }
+            else {
+                right = mid;
+            }
+        }
+        return left;
+    }
+
+    // 从根下降到(index, value)所在的叶子，path记录经过的(内部节点页号, 子节点下标)
+    int descend(const char* index, const TypeName& value, vector<pair<int, int>>& path) {
+        int page = tree_header.root;
+        for (int level = 1; level < tree_header.height; level++) {
+            const InnerNode* node = reinterpret_cast<const InnerNode*>(pin_page(page));
+            int child = child_for(*node, index, value);
+            int next = node->children[child];
+            unpin_page(page, false);
+            path.push_back(make_pair(page, child));
+            page = next;
+        }
+        return page;
+    }
+
+    // 把分裂产生的(separator, right_page)插入父节点，必要时继续向上分裂
+    void insert_into_parent(vector<pair<int, int>>& path, const Pair& separator, int right_page) {
+        if (path.empty()) {
+            // 根分裂，树长高一层
+            int new_root = allocate_page(false);
+            InnerNode* root = reinterpret_cast<InnerNode*>(pin_page(new_root));
+            root->header.count = 1;
+            root->keys[0] = separator;
+            root->children[0] = tree_header.root;
+            root->children[1] = right_page;
+            unpin_page(new_root, true);
+
+            tree_header.root = new_root;
+            tree_header.height++;
+            write_tree_header();
+            return;
+        }
+
+        int page = path.back().first;
+        int pos = path.back().second;
+        path.pop_back();
+
+        InnerNode* node = reinterpret_cast<InnerNode*>(pin_page(page));
+        for (int i = node->header.count; i > pos; i--) {
+            node->keys[i] = node->keys[i - 1];
+            node->children[i + 1] = node->children[i];
+        }
+        node->keys[pos] = separator;
+        node->children[pos + 1] = right_page;
+        node->header.count++;
+
+        if (node->header.count <= INNER_CAP) {
+            unpin_page(page, true);
+            return;
+        }
+
+        // 内部节点分裂：中间键上移
+        unpin_page(page, true);
+        int new_page = allocate_page(false);
+        node = reinterpret_cast<InnerNode*>(pin_page(page));
+        InnerNode* right = reinterpret_cast<InnerNode*>(pin_page(new_page));
+
+        int mid = node->header.count / 2;
+        Pair up = node->keys[mid];
+        right->header.count = node->header.count - mid - 1;
+        for (int i = 0; i < right->header.count; i++) {
+            right->keys[i] = node->keys[mid + 1 + i];
+            right->children[i] = node->children[mid + 1 + i];
+        }
+        right->children[right->header.count] = node->children[node->header.count];
+        node->header.count = mid;
+
+        unpin_page(page, true);
+        unpin_page(new_page, true);
+        insert_into_parent(path, up, new_page);
+    }
+
+    // (index, value)的比较，用于批量装载前的排序
+    static bool pair_less(const pair<string, TypeName>& a, const pair<string, TypeName>& b) {
+        int cmp = strcmp(a.first.c_str(), b.first.c_str());
+        return cmp < 0 || (cmp == 0 && a.second < b.second);
+    }
+
+    // 自底向上建树：已排序的条目依次装入叶子，再逐层建立内部节点
+    template<typename Iterator>
+    void load_sorted(Iterator begin, Iterator end, double fill_factor) {
+        const int leaf_cap = LEAF_CAP, inner_fanout = INNER_CAP + 1;
+        int per_leaf = max(1, min(leaf_cap, static_cast<int>(leaf_cap * fill_factor)));
+        int per_inner = max(2, min(inner_fanout, static_cast<int>(inner_fanout * fill_factor)));
+
+        // 当前层各节点的(最小条目, 页号)
+        vector<pair<Pair, int>> level;
+        int page = tree_header.root;
+        LeafNode* leaf = reinterpret_cast<LeafNode*>(pin_page(page));
+        Iterator prev = end;
+        for (Iterator it = begin; it != end; prev = it, ++it) {
+            if (prev != end && !pair_less(*prev, *it)) {
+                continue;  // 重复条目只保留一个
+            }
+            if (leaf->header.count >= per_leaf) {
+                int next = allocate_page(true);
+                leaf->header.next_leaf = next;
+                unpin_page(page, true);
+                page = next;
+                leaf = reinterpret_cast<LeafNode*>(pin_page(page));
+            }
+            Pair& entry = leaf->pairs[leaf->header.count++];
+            memset(&entry, 0, sizeof(Pair));
+            strncpy(entry.index, it->first.c_str(), INDEX_LEN - 1);
+            entry.value = it->second;
+            if (leaf->header.count == 1) {
+                level.push_back(make_pair(entry, page));
+            }
+        }
+        unpin_page(page, true);
+
+        // 每个内部节点的keys[i - 1]取children[i]子树中的最小条目
+        while (level.size() > 1) {
+            vector<pair<Pair, int>> upper;
+            for (size_t first = 0; first < level.size(); first += per_inner) {
+                size_t last = min(level.size(), first + per_inner);
+                int inner_page = allocate_page(false);
+                InnerNode* node = reinterpret_cast<InnerNode*>(pin_page(inner_page));
+                node->header.count = static_cast<int>(last - first) - 1;
+                for (size_t i = first; i < last; i++) {
+                    node->children[i - first] = level[i].second;
+                    if (i > first) {
+                        node->keys[i - first - 1] = level[i].first;
+                    }
+                }
+                unpin_page(inner_page, true);
+                upper.push_back(make_pair(level[first].first, inner_page));
+            }
+            level.swap(upper);
+            tree_header.height++;
+        }
+        if (!level.empty()) {
+            tree_header.root = level[0].second;
+        }
+        write_tree_header();
+    }
+
+    // 初始化新文件：树头页 + 一个空的根叶子
+    void init_new_file() {
+        tree_header.root = 1;
+        tree_header.first_leaf = 1;
+        tree_header.page_count = 1;
+        tree_header.height = 1;
+        char* page = pin_page(0, false);
+        memset(page, 0, BPT_PAGE_SIZE);
+        unpin_page(0, true);
+        allocate_page(true);
+    }
+
+public:
+    // 顺序扫描游标：沿叶子链表前进，任一时刻只固定当前叶子
+    // 游标存续期间不能修改BPlusTree
+    class Cursor {
+        friend class BPlusTree;
+        BPlusTree* tree;
+        ScanBound bound;
+        int page = -1;             // 当前叶子页号
+        int slot = 0;              // 叶子内下标
+        const LeafNode* leaf = nullptr;
+
+        Cursor(BPlusTree* tree, const ScanBound& bound) : tree(tree), bound(bound) {}
+
+        void release() {
+            if (leaf != nullptr) {
+                tree->unpin_page(page, false);
+                leaf = nullptr;
+            }
+        }
+
+        // 跳到下一个有效条目，越过终止条件时结束
+        void settle() {
+            while (leaf != nullptr) {
+                if (slot < leaf->header.count) {
+                    if (!bound.contains(leaf->pairs[slot].index)) {
+                        release();
+                    }
+                    return;
+                }
+                int next = leaf->header.next_leaf;
+                release();
+                if (next == -1) {
+                    return;
+                }
+                page = next;
+                slot = 0;
+                leaf = reinterpret_cast<const LeafNode*>(tree->pin_page(page));
+            }
+        }
+
+    public:
+        Cursor(Cursor&& other) : tree(other.tree), bound(other.bound), page(other.page), slot(other.slot),
+                                 leaf(other.leaf) {
+            other.leaf = nullptr;
+        }
+        Cursor(const Cursor&) = delete;
+        Cursor& operator=(const Cursor&) = delete;
+
+        ~Cursor() {
+            release();
+        }
+
+        bool valid() const {
+            return leaf != nullptr;
+        }
+
+        const char* index() const {
+            return leaf->pairs[slot].index;
+        }
+
+        const TypeName& value() const {
+            return leaf->pairs[slot].value;
+        }
+
+        void next() {
+            slot++;
+            settle();
+        }
+    };
+
+private:
+    // 定位到第一个index不小于给定值的条目
+    Cursor seek(const char* index, const ScanBound& bound) {
+        Cursor cursor(this, bound);
+        int page = tree_header.root;
+        for (int level = 1; level < tree_header.height; level++) {
+            const InnerNode* node = reinterpret_cast<const InnerNode*>(pin_page(page));
+            int next = node->children[first_child_for(*node, index)];
+            unpin_page(page, false);
+            page = next;
+        }
+        cursor.page = page;
+        cursor.leaf = reinterpret_cast<const LeafNode*>(pin_page(page));
+        int left = 0, right = cursor.leaf->header.count;
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            if (strcmp(cursor.leaf->pairs[mid].index, index) < 0) {
+                left = mid + 1;
+            }
+            else {
+                right = mid;
+            }
+        }
+        cursor.slot = left;
+        cursor.settle();
+        return cursor;
+    }
+
+public:
+    BPlusTree() = default;
+    explicit BPlusTree(const string& filename) : filename(filename) {
+        // 打开或创建文件
+        data_file.open(filename);
+        bool is_new = data_file.size() == 0;
+        pool->attach(this);
+        journal->attach(this);
+
+        if (is_new) {
+            init_new_file();
+        }
+        else {
+            const char* page = pin_page(0);
+            memcpy(&tree_header, page, sizeof(TreeHeader));
+            unpin_page(0, false);
+        }
+    }
+
+    ~BPlusTree() {
+        // 写回缓冲池中属于本文件的脏页
+        pool->detach(this);
+        journal->detach(this);
+        data_file.close();
+    }
+
+    // 缓冲池缺页时按页号读入
+    void read_page(int page, char* data, int size) override {
+        data_file.read(static_cast<long long>(page) * BPT_PAGE_SIZE, data, size);
+    }
+
+    // 缓冲池按页号写回
+    void write_page(int page, const char* data, int size) override {
+        data_file.write(static_cast<long long>(page) * BPT_PAGE_SIZE, data, size);
+    }
+
+    void sync() override {
+        data_file.sync();
+    }
+
+    bool journaled() const override {
+        return true;
+    }
+
+    // 把本次指令修改过的页面交给日志
+    void prepare_commit() override {
+        pool->collect(this, [this](int page, int begin, const char* data, int size) {
+            journal->record(filename, static_cast<long long>(page) * BPT_PAGE_SIZE + begin, data, size);
+        });
+    }
+
+    // 日志落盘后，交出的页面才可以被淘汰写回
+    void committed() override {
+        pool->logged(this);
+    }
+
+    // 检查点：写回本文件的全部脏页
+    void checkpoint() override {
+        pool->flush(this);
+    }
+
+    void flush() {
+        checkpoint();
+    }
+
+    // 批量装载(index, value)条目，元素类型为pair<string, TypeName>
+    // 树为空时自底向上建树，节点按fill_factor比例装填，未排序的输入先在内存中排序
+    // 树非空时退化为逐条插入
+    template<typename Iterator>
+    void bulk_load(Iterator begin, Iterator end, double fill_factor = 1.0) {
+        bool empty = tree_header.height == 1;
+        if (empty) {
+            const LeafNode* root = reinterpret_cast<const LeafNode*>(pin_page(tree_header.root));
+            empty = root->header.count == 0;
+            unpin_page(tree_header.root, false);
+        }
+        if (!empty) {
+            for (Iterator it = begin; it != end; ++it) {
+                insert(it->first.c_str(), it->second);
+            }
+            return;
+        }
+
+        if (is_sorted(begin, end, pair_less)) {
+            load_sorted(begin, end, fill_factor);
+        }
+        else {
+            vector<pair<string, TypeName>> sorted(begin, end);
+            sort(sorted.begin(), sorted.end(), pair_less);
+            load_sorted(sorted.begin(), sorted.end(), fill_factor);
+        }
+    }
+
+    // 插入操作，(index, value)已存在时不插入
+    void insert(const char* index, TypeName value) {
+        vector<pair<int, int>> path;
+        int page = descend(index, value, path);
+
+        LeafNode* leaf = reinterpret_cast<LeafNode*>(pin_page(page));
+        int pos = leaf_lower_bound(*leaf, index, value);
+        if (pos < leaf->header.count && compare(leaf->pairs[pos], index, value) == 0) {
+            unpin_page(page, false);
+            return;  // 已存在，不插入
+        }
+
+        for (int i = leaf->header.count; i > pos; i--) {
+            leaf->pairs[i] = leaf->pairs[i - 1];
+        }
+        memset(&leaf->pairs[pos], 0, sizeof(Pair));
+        strncpy(leaf->pairs[pos].index, index, INDEX_LEN - 1);
+        leaf->pairs[pos].value = value;
+        leaf->header.count++;
+
+        if (leaf->header.count <= LEAF_CAP) {
+            unpin_page(page, true);
+            return;
+        }
+
+        // 叶子分裂：后一半移入新叶子
+        unpin_page(page, true);
+        int new_page = allocate_page(true);
+        leaf = reinterpret_cast<LeafNode*>(pin_page(page));
+        LeafNode* right = reinterpret_cast<LeafNode*>(pin_page(new_page));
+
+        int split_point = leaf->header.count / 2;
+        right->header.count = leaf->header.count - split_point;
+        for (int i = 0; i < right->header.count; i++) {
+            right->pairs[i] = leaf->pairs[split_point + i];
+        }
+        leaf->header.count = split_point;
+        right->header.next_leaf = leaf->header.next_leaf;
+        leaf->header.next_leaf = new_page;
+        Pair separator = right->pairs[0];
+
+        unpin_page(page, true);
+        unpin_page(new_page, true);
+        insert_into_parent(path, separator, new_page);
+    }
+
+    // 删除操作
+    void remove(const char* index, TypeName value) {
+        vector<pair<int, int>> path;
+        int page = descend(index, value, path);
+
+        LeafNode* leaf = reinterpret_cast<LeafNode*>(pin_page(page));
+        int pos = leaf_lower_bound(*leaf, index, value);
+        if (pos >= leaf->header.count || compare(leaf->pairs[pos], index, value) != 0) {
+            unpin_page(page, false);
+            return;  // 未找到
+        }
+
+        for (int i = pos; i < leaf->header.count - 1; i++) {
+            leaf->pairs[i] = leaf->pairs[i + 1];
+        }
+        leaf->header.count--;
+        memset(&leaf->pairs[leaf->header.count], 0, sizeof(Pair));
+        unpin_page(page, true);
+    }
+
+    // 查找操作
+    vector<TypeName> find(const char* index) {
+        vector<TypeName> result;
+
+        // 下降到可能含有index的第一个叶子
+        int page = tree_header.root;
+        for (int level = 1; level < tree_header.height; level++) {
+            const InnerNode* node = reinterpret_cast<const InnerNode*>(pin_page(page));
+            int next = node->children[first_child_for(*node, index)];
+            unpin_page(page, false);
+            page = next;
+        }
+
+        // 沿叶子链表收集所有匹配项
+        bool done = false;
+        while (page != -1 && !done) {
+            const LeafNode* leaf = reinterpret_cast<const LeafNode*>(pin_page(page));
+            for (int i = 0; i < leaf->header.count; i++) {
+                int cmp = strcmp(leaf->pairs[i].index, index);
+                if (cmp == 0) {
+                    result.push_back(leaf->pairs[i].value);
+                }
+                else if (cmp > 0) {
+                    done = true;
+                    break;
+                }
+            }
+            int next = leaf->header.next_leaf;
+            unpin_page(page, false);
+            page = next;
+        }
+        return result;
+    }
+
+    // 从第一个index不小于给定值的条目开始扫描到末尾
+    Cursor lower_bound(const char* index) {
+        return seek(index, ScanBound());
+    }
+
+    // 扫描所有以prefix开头的条目
+    Cursor prefix(const char* prefix) {
+        return seek(prefix, ScanBound(ScanBound::PREFIX, prefix));
+    }
+
+    // 扫描index在[low, high]中的条目
+    Cursor range(const char* low, const char* high) {
+        return seek(low, ScanBound(ScanBound::UPPER, high));
+    }
+
+    // 与BlockList::vacuum接口一致；删除时不合并节点，也不整理页面
+    bool vacuum(int budget) {
+        return true;
+    }
+
+    // 获取全部元素
+    std::vector<TypeName> get_all() {
+        std::vector<TypeName> result;
+
+        int page = tree_header.first_leaf;
+        while (page != -1) {
+            const LeafNode* leaf = reinterpret_cast<const LeafNode*>(pin_page(page));
+            for (int i = 0; i < leaf->header.count; i++) {
+                result.push_back(leaf->pairs[i].value);
+            }
+            int next = leaf->header.next_leaf;
+            unpin_page(page, false);
+            page = next;
+        }
+        return result;
+    }
+};
+
+#endif //BOOKSTORE_2025_BPLUSTREE_H
@@ -0,0 +1,44 @@
+#ifndef BOOKSTORE_2025_BLOOMFILTER_H
+#define BOOKSTORE_2025_BLOOMFILTER_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 按块划分的布隆过滤器：每个块一段固定长度的位图，块号由调用方给出
+// 只支持加入，删除条目后的残留位在块整体重写时清除
+// 正常关闭时保存到旁路文件，打开时读入后即删除该文件；异常退出后文件不存在，由调用方重建
+class BloomFilter {
+private:
+    static const int HASH_COUNT = 4;    // 每个键置位的个数
+
+    int words_per_block;               // 每块位图的uint64_t个数
+    std::vector<uint64_t> bits;        // 各块位图依次排列
+
+    static uint64_t hash(const char* key);
+
+    // 保证块block的位图存在
+    void reserve(int block);
+
+public:
+    explicit BloomFilter(int bits_per_block);
+
+    // 清空块block的位图
+    void clear(int block);
+
+    void add(int block, const char* key);
+
+    // 交换两块的位图；把from的位图移到to并清空from（块的NodeBody换位置时使用）
+    void swap(int a, int b);
+    void move(int from, int to);
+
+    // 返回false时块block中一定没有key
+    bool may_contain(int block, const char* key) const;
+
+    // 读入旁路文件并删除它；文件不存在或stamp不符时返回false，位图保持为空
+    bool load(const std::string& filename, uint64_t stamp);
+
+    // 写出旁路文件，stamp用于下次打开时核对数据文件
+    void save(const std::string& filename, uint64_t stamp) const;
+};
+
+#endif //BOOKSTORE_2025_BLOOMFILTER_H
@@ -1,9 +1,14 @@
 #ifndef BOOKSTORE_2025_BOOK_H
 #define BOOKSTORE_2025_BOOK_H
-#include "Storage.h"
+#include "Index.h"
 #include "Account.h"
 #include "Log.h"
 #include"MemoryRiver.h"
+#include "SlottedStore.h"
+#include "StringDictionary.h"
+
+const int PRICE_KEY_LEN = 37;  // 价格索引键的长度（16位十六进制价格、20位ISBN和结尾0）
+
 struct Book {
     char ISBN[21];  // 除不可见字符以外 ASCII 字符
     char BookName[61];  // 除不可见字符和英文双引号以外 ASCII 字符
@@ -26,13 +31,25 @@ struct Book {
     }
 };
 
+// 图书中买卖时修改的数值字段（热数据），按图书记录编号依次存放
+struct BookStock {
+    int Stock;
+    double Price;
+    double TotalCost;
+
+    BookStock(): Stock(0), Price(0), TotalCost(0) {}
+};
+
 class BookSystem {
 private:
-    MemoryRiver<Book> bookStorage; // 图书信息完整存储(使用MemoryRiver)
+    // 图书按冷热字段分开存储，编号为i的图书的文本和数值分别是两处的第i条记录
+    SlottedStore bookStorage;            // 图书文本字段（变长记录），记录编号即各索引中的storage_pos
+    MemoryRiver<BookStock> stockStorage; // 图书数值字段，buy和import只读写这里的24字节
+    StringDictionary dictionary;         // 作者和关键词的字典，图书记录和索引中只存编号
 
     struct BookIndex {
         char ISBN[21];  //ISBN
-        int storage_pos;  // position in MemoryRiver
+        int storage_pos;  // 图书记录编号
 
         bool operator <(const BookIndex& other) const {
             return strcmp(ISBN, other.ISBN) < 0;
@@ -42,22 +59,62 @@ private:
         }
     };
 
-    BlockList<21, BookIndex> ISBNIndex;  // ISBN索引
-    BlockList<61, BookIndex> nameIndex;  // 书名索引
-    BlockList<61, BookIndex> authorIndex;  // 作者名索引
-    BlockList<61, BookIndex> keywordIndex;  // 关键词索引
+    IndexEngine<21, BookIndex> ISBNIndex;  // ISBN索引（有序，用于show列出全部图书）
+    HashIndex<21, BookIndex> ISBNHash;     // ISBN哈希索引，用于按ISBN精确查找
+    IndexEngine<61, BookIndex> nameIndex;  // 书名索引
+    IndexEngine<DICTIONARY_KEY_LEN, BookIndex> authorIndex;  // 作者索引，键为作者在字典中的编号
+    InvertedIndex<DICTIONARY_KEY_LEN> keywordIndex;  // 关键词倒排索引：关键词的字典编号 -> 图书记录编号
+    IndexEngine<PRICE_KEY_LEN, BookIndex> priceIndex;  // 价格索引（键为价格的保序编码接ISBN），用于按价格区间查询
 
     AccountSystem* accountSystem;
     LogSystem* logSystem;
 
     bool selected;  // 当前是否选中图书
     char selected_ISBN[21];  // 当前选中图书的ISBN
+
+    // 编号为id的图书的数值记录位置
+    static long long stock_pos(int id);
+
+    // 文本字段编码为变长记录：首字节为格式版本0，ISBN和书名为1字节长度加内容，作者和各关键词为字典编号
+    std::string encode_text(const Book& book);
+    void decode_text(const std::string& record, Book& book);
+
+    // 作者或关键词在索引中的键；intern为true时为字典中没有的字符串分配编号
+    std::string string_key(const std::string& s, bool intern);
+
+    // 读出、追加、更新整本图书（文本和数值都读写），pos为图书记录编号
+    void read_book(Book& book, int pos);
+    void read_books(const std::vector<int>& positions, std::vector<Book>& books);
+    int write_book(const Book& book);
+    void update_book(const Book& book, int pos);
+
+    // 旧格式的图书数据（整本定长记录）转为变长记录
+    void migrate_book_data();
+
+    // 索引文件丢失时由图书数据批量重建全部索引
+    void rebuild_indexes();
+
+    // 旧的以字符串为键的作者、关键词索引改为以字典编号为键
+    void migrate_author_index();
+    void migrate_string_indexes();
+
+    // 图书从位置from改为编号to后，更新ISBN和价格索引
+    void relocate_keyed(const Book& book, int from, int to);
+
+    // 按原位置 -> 新编号改写index中全部条目的位置
+    template<int INDEX_LEN>
+    void relocate_all(IndexEngine<INDEX_LEN, BookIndex>& index, const std::map<int, int>& moved);
+
+    // 取出索引中所有以prefix开头的条目
+    template<int INDEX_LEN>
+    static std::vector<BookIndex> scan_prefix(IndexEngine<INDEX_LEN, BookIndex>& index, const std::string& prefix);
 public:
     BookSystem(AccountSystem* as, LogSystem* ls);
     ~BookSystem();
 
     static bool ISBN_check(const std::string& s);
     static bool other_check(const std::string& s);
+    static bool price_check(const std::string& s);
     static bool keywords_repetition(const std::vector<std::string>& keywords);
 
 
@@ -67,7 +124,8 @@ public:
     void show();
 
     // 输出图书信息或空行（无满足条件的图书），[Keyword] 中出现多个关键词则操作失败
-    // some:name, author...
+    // some:name, author...；name-prefix和author-prefix按前缀查询
+    // some为price时value为LO..HI，按价格（相同时按ISBN）顺序输出价格在[LO, HI]中的图书
     void show(const string& some, const string& value);
 
     // 购买指定数量的指定图书,减少库存，以浮点数输出购买图书所需的总金额
@@ -89,5 +147,8 @@ public:
     // 如未选中图书则操作失败；购入数量为非正整数则操作失败；交易总额为非正数则操作失败。
     // {3}
     void import(int Quantity, double TotalCost);
+
+    // 每条指令后调用：增量整理各索引文件（图书记录编号固定，数据页的空间由SlottedStore在页内回收）
+    void vacuum();
 };
 #endif //BOOKSTORE_2025_BOOK_H
\ No newline at end of file
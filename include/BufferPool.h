@@ -0,0 +1,134 @@
+#ifndef BOOKSTORE_2025_BUFFERPOOL_H
+#define BOOKSTORE_2025_BUFFERPOOL_H
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// 页面所属的文件，缓冲池在缺页、写回和检查点时回调
+// offset是页面在该文件中的编号，由文件自行解释（字节偏移或页号）
+class PageOwner {
+public:
+    virtual ~PageOwner() = default;
+
+    // 读入offset对应的size字节
+    virtual void read_page(int offset, char* data, int size) = 0;
+
+    // 将size字节写到offset对应的位置（不要求立即刷盘）
+    virtual void write_page(int offset, const char* data, int size) = 0;
+
+    // 把已写回的页面刷到磁盘
+    virtual void sync() = 0;
+
+    // 是否经由预写日志提交：是则页面的修改在记入日志前不会被淘汰写回
+    virtual bool journaled() const { return false; }
+};
+
+const size_t DEFAULT_POOL_CAPACITY = 16 << 20;  // 默认缓冲池容量（字节）
+
+// LRU缓冲池：页面按(文件, 偏移)缓存，支持固定和脏页写回
+// 脏页只在被淘汰、检查点或文件关闭时写回；日志文件的页面须先经collect记入日志，且日志落盘（logged）后才能被淘汰
+// 记入日志的是页面相对上次记入内容的变化：已记入日志、尚未写回的页面保留一份副本作比较基准（计入容量），
+// 其余页面以磁盘上的内容为基准
+// 各接口由内部互斥锁保护，可被多个线程同时调用；写回在锁内进行，缺页读入在锁外进行，
+// 读入期间固定同一页面的线程等待读入完成
+class BufferPool {
+private:
+    struct Frame {
+        PageOwner* owner;                // 所属文件
+        int offset;                      // 页面在文件中的偏移
+        int size;                        // 页面大小
+        int pin_count;                   // 固定计数，大于0时不可淘汰
+        bool dirty;                      // 是否需要写回
+        bool unlogged;                   // 是否有尚未记入日志的修改
+        bool logging;                    // 修改已交给日志，但日志记录尚未落盘
+        bool loading;                    // 正在锁外读入，内容尚不可用
+        bool fresh;                      // 未从磁盘读入的新页面，首次记入日志时交出整页
+        std::unique_ptr<char[]> data;    // 页面内容
+        std::unique_ptr<char[]> base;    // 已记入日志、尚未写回的内容；为空时以磁盘上的内容为准
+    };
+
+    struct FrameKey {
+        PageOwner* owner;
+        int offset;
+
+        bool operator==(const FrameKey& other) const {
+            return owner == other.owner && offset == other.offset;
+        }
+    };
+
+    struct FrameKeyHash {
+        size_t operator()(const FrameKey& key) const {
+            return std::hash<const void*>()(key.owner) ^ (std::hash<int>()(key.offset) * 31);
+        }
+    };
+
+    std::list<Frame> frames;      // 表头为最近使用的页面
+    std::unordered_map<FrameKey, std::list<Frame>::iterator, FrameKeyHash> table;
+    std::vector<PageOwner*> owners;   // 已注册的文件
+    std::vector<Frame*> unlogged_frames;  // 有尚未记入日志的修改的页面（仅日志文件）
+    std::vector<Frame*> logging_frames;   // 已交给日志、记录尚未落盘的页面
+    size_t capacity;              // 容量（字节）
+    size_t used;                  // 已用字节
+    std::mutex latch;             // 保护以上全部成员
+    std::condition_variable loaded;   // 有页面读入完成
+
+    // 淘汰未固定的页面，直到能再容纳need字节
+    void evict(size_t need);
+
+    // 写回脏页
+    void write_back(Frame& frame);
+
+    // 释放页面的日志基准副本
+    void drop_base(Frame& frame);
+
+    // 页面将被移除：从待记入日志和待落盘的列表中去掉
+    void forget(Frame* frame);
+
+    // 写回某个文件的全部脏页并刷盘（调用方持有latch）
+    void flush_owner(PageOwner* owner);
+
+public:
+    explicit BufferPool(size_t capacity = DEFAULT_POOL_CAPACITY);
+    ~BufferPool() = default;
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // 所有索引共用的缓冲池
+    static BufferPool& shared();
+
+    void set_capacity(size_t bytes);
+
+    // 注册/注销文件；注销时写回并移除其全部页面
+    void attach(PageOwner* owner);
+    void detach(PageOwner* owner);
+
+    // 取得并固定页面；load为false时不读盘，新页面内容为全0
+    char* pin(PageOwner* owner, int offset, int size, bool load = true);
+
+    // 解除固定，dirty表示页面已被修改
+    void unpin(PageOwner* owner, int offset, bool dirty);
+
+    // 丢弃页面，不写回（页面所在位置已改作他用）；页面须未被固定
+    void discard(PageOwner* owner, int offset);
+
+    // 把某个文件自上次调用以来修改过的页面交给log：只交出与上次记入日志的内容不同的字节区间
+    // log的参数为(页面偏移, 区间在页内的起点, 区间内容, 区间长度)
+    void collect(PageOwner* owner, const std::function<void(int, int, const char*, int)>& log);
+
+    // collect交出的日志记录已落盘，之后这些页面可以被淘汰
+    void logged(PageOwner* owner);
+
+    // 写回某个文件的全部脏页并刷盘
+    void flush(PageOwner* owner);
+
+    // 检查点：写回所有文件的脏页
+    void checkpoint();
+};
+
+#endif //BOOKSTORE_2025_BUFFERPOOL_H
@@ -0,0 +1,413 @@
+#ifndef BOOKSTORE_2025_HASHINDEX_H
+#define BOOKSTORE_2025_HASHINDEX_H
+#include "Storage.h"
+
+const int HASH_PAGE_SIZE = 4096;    // 哈希索引页面大小
+const int MAX_GLOBAL_DEPTH = 19;    // 目录最多2^19项
+const int DIR_PER_PAGE = HASH_PAGE_SIZE / (int)sizeof(int);  // 每个目录页的项数
+
+// 基于磁盘页面的可扩展哈希，只支持精确查找；insert/find/remove的语义与BlockList一致
+// 第0页为文件头，其中记录目录所在的页；目录在打开时整体读入内存，每次查找只读一个桶页
+// 桶满时分裂并按需将目录加倍；键的哈希值全部相同或目录已达上限时改为挂溢出页
+// 删除时不合并桶；所有页面经缓冲池读写并经预写日志提交
+template<int INDEX_LEN, typename TypeName>
+class HashIndex : public PageOwner, public JournalClient {
+private:
+    typedef KeyValue<INDEX_LEN, TypeName> Pair;
+
+    // 文件头（第0页）
+    struct HashHeader {
+        int global_depth;     // 目录的位数
+        int page_count;       // 已分配页数
+        int entry_count;      // 条目总数
+        int dir_page_count;   // 目录页数
+        int dir_pages[(HASH_PAGE_SIZE - 4 * (int)sizeof(int)) / (int)sizeof(int)];  // 目录页号
+    };
+
+    // 桶头
+    struct BucketHeader {
+        int local_depth;      // 桶的位数
+        int count;            // 条目数
+        int overflow;         // 溢出页号，没有时为-1
+        int padding;
+    };
+
+    static const int BUCKET_CAP = (HASH_PAGE_SIZE - (int)sizeof(BucketHeader)) / (int)sizeof(Pair);
+
+    struct Bucket {
+        BucketHeader header;
+        Pair pairs[BUCKET_CAP];
+    };
+
+    static_assert(BUCKET_CAP >= 2, "HASH_PAGE_SIZE too small for this key");
+    static_assert(sizeof(HashHeader) <= HASH_PAGE_SIZE && sizeof(Bucket) <= HASH_PAGE_SIZE,
+                  "hash index page overflow");
+    static_assert((1 << MAX_GLOBAL_DEPTH) / (HASH_PAGE_SIZE / sizeof(int))
+                  <= sizeof(HashHeader::dir_pages) / sizeof(int), "hash directory does not fit in the header");
+
+    PositionalFile data_file;     // 数据文件
+    string filename;              // 文件名
+    BufferPool* pool = &BufferPool::shared();  // 页面缓冲池
+    Journal* journal = &Journal::shared();     // 预写日志
+    HashHeader hash_header;       // 文件头缓存
+    vector<int> directory;        // 目录：哈希值低global_depth位 -> 桶页号
+
+    // 取得并固定页面
+    char* pin_page(int page, bool load = true) {
+        return pool->pin(this, page, HASH_PAGE_SIZE, load);
+    }
+
+    void unpin_page(int page, bool dirty) {
+        pool->unpin(this, page, dirty);
+    }
+
+    // 写回文件头
+    void write_hash_header() {
+        char* page = pin_page(0);
+        memcpy(page, &hash_header, sizeof(HashHeader));
+        unpin_page(0, true);
+    }
+
+    // 分配一个新页面并清零
+    int allocate_page() {
+        int page = hash_header.page_count++;
+        char* data = pin_page(page, false);
+        memset(data, 0, HASH_PAGE_SIZE);
+        unpin_page(page, true);
+        return page;
+    }
+
+    // 分配一个空桶
+    int allocate_bucket(int local_depth) {
+        int page = allocate_page();
+        Bucket* bucket = reinterpret_cast<Bucket*>(pin_page(page));
+        bucket->header.local_depth = local_depth;
+        bucket->header.overflow = -1;
+        unpin_page(page, true);
+        return page;
+    }
+
+    // 把内存中的目录写回目录页，目录变大时先分配新的目录页
+    void write_directory() {
+        int need = max(1, (int)directory.size() / DIR_PER_PAGE);
+        while (hash_header.dir_page_count < need) {
+            hash_header.dir_pages[hash_header.dir_page_count++] = allocate_page();
+        }
+        for (int i = 0; i < need; i++) {
+            int page = hash_header.dir_pages[i];
+            int begin = i * DIR_PER_PAGE;
+            int count = min(DIR_PER_PAGE, (int)directory.size() - begin);
+            char* data = pin_page(page);
+            memcpy(data, directory.data() + begin, count * sizeof(int));
+            unpin_page(page, true);
+        }
+        write_hash_header();
+    }
+
+    // 打开文件时读入目录
+    void load_directory() {
+        directory.resize(static_cast<size_t>(1) << hash_header.global_depth);
+        for (int i = 0; i < hash_header.dir_page_count; i++) {
+            int begin = i * DIR_PER_PAGE;
+            int count = min(DIR_PER_PAGE, (int)directory.size() - begin);
+            const char* data = pin_page(hash_header.dir_pages[i]);
+            memcpy(directory.data() + begin, data, count * sizeof(int));
+            unpin_page(hash_header.dir_pages[i], false);
+        }
+    }
+
+    // FNV-1a后再做一次混合，目录取低位
+    static uint64_t hash(const char* index) {
+        uint64_t h = 14695981039346656037ull;
+        for (const unsigned char* p = reinterpret_cast<const unsigned char*>(index); *p != 0; p++) {
+            h ^= *p;
+            h *= 1099511628211ull;
+        }
+        h ^= h >> 29;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 32;
+        return h;
+    }
+
+    int bucket_for(uint64_t h) const {
+        return directory[h & (directory.size() - 1)];
+    }
+
+    // 在桶链中查找(index, value)
+    bool contains(int page, const char* index, const TypeName& value) {
+        while (page != -1) {
+            const Bucket* bucket = reinterpret_cast<const Bucket*>(pin_page(page));
+            for (int i = 0; i < bucket->header.count; i++) {
+                const Pair& pair = bucket->pairs[i];
+                if (strcmp(pair.index, index) == 0 && !(pair.value < value) && !(pair.value > value)) {
+                    unpin_page(page, false);
+                    return true;
+                }
+            }
+            int next = bucket->header.overflow;
+            unpin_page(page, false);
+            page = next;
+        }
+        return false;
+    }
+
+    // 能否通过分裂为桶腾出空间：桶没有溢出页、目录未到上限且桶内哈希值不全相同
+    bool can_split(const Bucket& bucket) const {
+        if (bucket.header.overflow != -1 || bucket.header.local_depth >= MAX_GLOBAL_DEPTH) {
+            return false;
+        }
+        uint64_t first = hash(bucket.pairs[0].index);
+        for (int i = 1; i < bucket.header.count; i++) {
+            if (hash(bucket.pairs[i].index) != first) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 分裂桶页page：按哈希值第local_depth位分到两个桶，必要时先将目录加倍
+    void split_bucket(int page) {
+        Bucket* bucket = reinterpret_cast<Bucket*>(pin_page(page));
+        int depth = bucket->header.local_depth;
+        unpin_page(page, false);
+
+        if (depth == hash_header.global_depth) {
+            size_t size = directory.size();
+            directory.resize(size * 2);
+            copy(directory.begin(), directory.begin() + size, directory.begin() + size);
+            hash_header.global_depth++;
+        }
+
+        int new_page = allocate_bucket(depth + 1);
+        bucket = reinterpret_cast<Bucket*>(pin_page(page));
+        Bucket* sibling = reinterpret_cast<Bucket*>(pin_page(new_page));
+        int kept = 0;
+        for (int i = 0; i < bucket->header.count; i++) {
+            if ((hash(bucket->pairs[i].index) >> depth) & 1) {
+                sibling->pairs[sibling->header.count++] = bucket->pairs[i];
+            }
+            else {
+                bucket->pairs[kept++] = bucket->pairs[i];
+            }
+        }
+        memset(bucket->pairs + kept, 0, (bucket->header.count - kept) * sizeof(Pair));
+        bucket->header.count = kept;
+        bucket->header.local_depth = depth + 1;
+        unpin_page(new_page, true);
+        unpin_page(page, true);
+
+        // 指向原桶且第depth位为1的目录项改指向新桶
+        for (size_t i = 0; i < directory.size(); i++) {
+            if (directory[i] == page && ((i >> depth) & 1)) {
+                directory[i] = new_page;
+            }
+        }
+        write_directory();
+    }
+
+    // 初始化新文件：文件头、一个目录页和一个空桶
+    void init_new_file() {
+        memset(&hash_header, 0, sizeof(HashHeader));
+        hash_header.page_count = 1;
+        directory.assign(1, allocate_bucket(0));
+        write_directory();
+    }
+
+public:
+    HashIndex() = default;
+    explicit HashIndex(const string& filename) : filename(filename) {
+        // 打开或创建文件
+        data_file.open(filename);
+        bool is_new = data_file.size() == 0;
+        pool->attach(this);
+        journal->attach(this);
+
+        if (is_new) {
+            init_new_file();
+        }
+        else {
+            const char* page = pin_page(0);
+            memcpy(&hash_header, page, sizeof(HashHeader));
+            unpin_page(0, false);
+            load_directory();
+        }
+    }
+
+    ~HashIndex() {
+        // 写回缓冲池中属于本文件的脏页
+        pool->detach(this);
+        journal->detach(this);
+        data_file.close();
+    }
+
+    // 缓冲池缺页时按页号读入
+    void read_page(int page, char* data, int size) override {
+        data_file.read(static_cast<long long>(page) * HASH_PAGE_SIZE, data, size);
+    }
+
+    // 缓冲池按页号写回
+    void write_page(int page, const char* data, int size) override {
+        data_file.write(static_cast<long long>(page) * HASH_PAGE_SIZE, data, size);
+    }
+
+    void sync() override {
+        data_file.sync();
+    }
+
+    bool journaled() const override {
+        return true;
+    }
+
+    // 把本次指令修改过的页面交给日志
+    void prepare_commit() override {
+        pool->collect(this, [this](int page, int begin, const char* data, int size) {
+            journal->record(filename, static_cast<long long>(page) * HASH_PAGE_SIZE + begin, data, size);
+        });
+    }
+
+    // 日志落盘后，交出的页面才可以被淘汰写回
+    void committed() override {
+        pool->logged(this);
+    }
+
+    // 检查点：写回本文件的全部脏页
+    void checkpoint() override {
+        pool->flush(this);
+    }
+
+    void flush() {
+        checkpoint();
+    }
+
+    // 条目总数
+    int size() const {
+        return hash_header.entry_count;
+    }
+
+    // 插入操作，(index, value)已存在时不插入
+    void insert(const char* index, TypeName value) {
+        uint64_t h = hash(index);
+        if (contains(bucket_for(h), index, value)) {
+            return;
+        }
+
+        Pair pair;
+        memset(&pair, 0, sizeof(Pair));
+        strncpy(pair.index, index, INDEX_LEN - 1);
+        pair.value = value;
+
+        while (true) {
+            int page = bucket_for(h);
+            Bucket* bucket = reinterpret_cast<Bucket*>(pin_page(page));
+            if (bucket->header.count < BUCKET_CAP) {
+                bucket->pairs[bucket->header.count++] = pair;
+                unpin_page(page, true);
+                break;
+            }
+            bool splittable = can_split(*bucket);
+            unpin_page(page, false);
+            if (splittable) {
+                split_bucket(page);
+                continue;
+            }
+
+            // 无法分裂：放进溢出链中第一个有空位的页，都满时在链尾追加
+            while (true) {
+                bucket = reinterpret_cast<Bucket*>(pin_page(page));
+                if (bucket->header.count < BUCKET_CAP) {
+                    bucket->pairs[bucket->header.count++] = pair;
+                    unpin_page(page, true);
+                    break;
+                }
+                int next = bucket->header.overflow;
+                int depth = bucket->header.local_depth;
+                unpin_page(page, false);
+                if (next == -1) {
+                    next = allocate_bucket(depth);
+                    bucket = reinterpret_cast<Bucket*>(pin_page(page));
+                    bucket->header.overflow = next;
+                    unpin_page(page, true);
+                }
+                page = next;
+            }
+            break;
+        }
+        hash_header.entry_count++;
+        write_hash_header();
+    }
+
+    // 删除操作
+    void remove(const char* index, TypeName value) {
+        int page = bucket_for(hash(index));
+        while (page != -1) {
+            Bucket* bucket = reinterpret_cast<Bucket*>(pin_page(page));
+            for (int i = 0; i < bucket->header.count; i++) {
+                Pair& pair = bucket->pairs[i];
+                if (strcmp(pair.index, index) == 0 && !(pair.value < value) && !(pair.value > value)) {
+                    // 用最后一个条目填补空位
+                    int last = --bucket->header.count;
+                    pair = bucket->pairs[last];
+                    memset(&bucket->pairs[last], 0, sizeof(Pair));
+                    unpin_page(page, true);
+                    hash_header.entry_count--;
+                    write_hash_header();
+                    return;
+                }
+            }
+            int next = bucket->header.overflow;
+            unpin_page(page, false);
+            page = next;
+        }
+    }
+
+    // 查找操作
+    vector<TypeName> find(const char* index) {
+        vector<TypeName> result;
+        int page = bucket_for(hash(index));
+        while (page != -1) {
+            const Bucket* bucket = reinterpret_cast<const Bucket*>(pin_page(page));
+            for (int i = 0; i < bucket->header.count; i++) {
+                if (strcmp(bucket->pairs[i].index, index) == 0) {
+                    result.push_back(bucket->pairs[i].value);
+                }
+            }
+            int next = bucket->header.overflow;
+            unpin_page(page, false);
+            page = next;
+        }
+
+        // 排序结果
+        sort(result.begin(), result.end());
+        return result;
+    }
+
+    // 获取全部元素（按桶的顺序，不排序）
+    vector<TypeName> get_all() {
+        vector<TypeName> result;
+        vector<int> buckets(directory);
+        sort(buckets.begin(), buckets.end());
+        buckets.erase(unique(buckets.begin(), buckets.end()), buckets.end());
+        for (int page : buckets) {
+            while (page != -1) {
+                const Bucket* bucket = reinterpret_cast<const Bucket*>(pin_page(page));
+                for (int i = 0; i < bucket->header.count; i++) {
+                    result.push_back(bucket->pairs[i].value);
+                }
+                int next = bucket->header.overflow;
+                unpin_page(page, false);
+                page = next;
+            }
+        }
+        return result;
+    }
+
+    // 批量装载(index, value)条目，元素类型为pair<string, TypeName>；哈希表无序，逐条插入
+    template<typename Iterator>
+    void bulk_load(Iterator begin, Iterator end) {
+        for (Iterator it = begin; it != end; ++it) {
+            insert(it->first.c_str(), it->second);
+        }
+    }
+};
+
+#endif //BOOKSTORE_2025_HASHINDEX_H
@@ -0,0 +1,18 @@
+#ifndef BOOKSTORE_2025_INDEX_H
+#define BOOKSTORE_2025_INDEX_H
+#include "Storage.h"
+#include "BPlusTree.h"
+#include "HashIndex.h"
+#include "InvertedIndex.h"
+
+// 各系统使用的有序索引引擎，可在BlockList与BPlusTree之间切换（定义BOOKSTORE_USE_BPLUSTREE时使用BPlusTree）
+// 只做精确查找的索引直接使用HashIndex
+#ifdef BOOKSTORE_USE_BPLUSTREE
+template<int INDEX_LEN, typename TypeName>
+using IndexEngine = BPlusTree<INDEX_LEN, TypeName>;
+#else
+template<int INDEX_LEN, typename TypeName>
+using IndexEngine = BlockList<INDEX_LEN, TypeName>;
+#endif
+
+#endif //BOOKSTORE_2025_INDEX_H
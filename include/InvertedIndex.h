@@ -0,0 +1,451 @@
+#ifndef BOOKSTORE_2025_INVERTEDINDEX_H
+#define BOOKSTORE_2025_INVERTEDINDEX_H
+#include "HashIndex.h"
+
+const int POSTING_PAGE_SIZE = 4096;    // 倒排表页面大小
+
+// 倒排索引：键 -> 升序排列、互不相同的非负整数（图书在数据文件中的位置）
+// 键字典是一个HashIndex<INDEX_LEN, int>，值为该键跳表首页的页号；倒排表单独存放在另一个文件中
+// 每个键的位置分块存放，每块一页：块内第一个位置按原值、之后的位置按与前一个位置之差，都以varint编码
+// 跳表页依次记录各块的(第一个位置, 块页号)，多页时用next串起，首页另记该键的位置总数
+// 插入和删除先在跳表上二分到一个块，只重新编码这一块；块放不下时对半分裂，块变空时释放
+// 查询一个键时依次解码各块，是顺序读
+// 页面经共享缓冲池读写并经预写日志提交，释放的页面进入空闲链表
+template<int INDEX_LEN>
+class InvertedIndex : public PageOwner, public JournalClient {
+private:
+    // 文件头（第0页）
+    struct PostingHeader {
+        int page_count;       // 已分配页数
+        int free_page;        // 空闲页链表头，没有时为-1
+    };
+
+    // 跳表页
+    struct SkipHeader {
+        int count;            // 该键的位置总数（只在首页有效）
+        int entry_count;      // 本页的跳表项数
+        int next;             // 下一个跳表页，没有时为-1
+        int padding;
+    };
+
+    struct SkipEntry {
+        int first;            // 块中第一个位置
+        int page;             // 块页号
+    };
+
+    static const int SKIPS_PER_PAGE = (POSTING_PAGE_SIZE - (int)sizeof(SkipHeader)) / (int)sizeof(SkipEntry);
+
+    struct SkipPage {
+        SkipHeader header;
+        SkipEntry entries[SKIPS_PER_PAGE];
+    };
+
+    // 块页
+    struct BlockHeader {
+        int count;            // 位置数
+        int used;             // 已用字节数
+    };
+
+    static const int BLOCK_BYTES = POSTING_PAGE_SIZE - (int)sizeof(BlockHeader);
+
+    struct BlockPage {
+        BlockHeader header;
+        unsigned char data[BLOCK_BYTES];
+    };
+
+    static_assert(sizeof(SkipPage) <= POSTING_PAGE_SIZE && sizeof(BlockPage) <= POSTING_PAGE_SIZE,
+                  "posting page overflow");
+
+    // 一个键的跳表在内存中的形式
+    struct SkipList {
+        int count = 0;                 // 位置总数
+        vector<SkipEntry> entries;     // 各块
+        vector<int> pages;             // 跳表页，pages[0]为首页
+    };
+
+    HashIndex<INDEX_LEN, int> dictionary;  // 键 -> 跳表首页
+    PositionalFile data_file;     // 倒排表文件
+    string filename;              // 倒排表文件名
+    BufferPool* pool = &BufferPool::shared();  // 页面缓冲池
+    Journal* journal = &Journal::shared();     // 预写日志
+    PostingHeader posting_header; // 文件头缓存
+
+    char* pin_page(int page, bool load = true) {
+        return pool->pin(this, page, POSTING_PAGE_SIZE, load);
+    }
+
+    void unpin_page(int page, bool dirty) {
+        pool->unpin(this, page, dirty);
+    }
+
+    void write_posting_header() {
+        char* page = pin_page(0);
+        memcpy(page, &posting_header, sizeof(PostingHeader));
+        unpin_page(0, true);
+    }
+
+    // 分配一个清零的页面，优先取空闲链表
+    int allocate_page() {
+        int page;
+        if (posting_header.free_page != -1) {
+            page = posting_header.free_page;
+            const char* data = pin_page(page);
+            memcpy(&posting_header.free_page, data, sizeof(int));
+            unpin_page(page, false);
+        }
+        else {
+            page = posting_header.page_count++;
+        }
+        char* data = pin_page(page, false);
+        memset(data, 0, POSTING_PAGE_SIZE);
+        unpin_page(page, true);
+        write_posting_header();
+        return page;
+    }
+
+    // 释放页面到空闲链表
+    void free_page(int page) {
+        char* data = pin_page(page, false);
+        memset(data, 0, POSTING_PAGE_SIZE);
+        memcpy(data, &posting_header.free_page, sizeof(int));
+        unpin_page(page, true);
+        posting_header.free_page = page;
+        write_posting_header();
+    }
+
+    static int varint_size(uint32_t value) {
+        int size = 1;
+        while (value >= 0x80) {
+            value >>= 7;
+            size++;
+        }
+        return size;
+    }
+
+    static unsigned char* put_varint(unsigned char* out, uint32_t value) {
+        while (value >= 0x80) {
+            *out++ = static_cast<unsigned char>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<unsigned char>(value);
+        return out;
+    }
+
+    // 解码块中的全部位置，追加到values
+    void read_block(int page, vector<int>& values) {
+        const BlockPage* block = reinterpret_cast<const BlockPage*>(pin_page(page));
+        const unsigned char* in = block->data;
+        uint32_t value = 0;
+        for (int i = 0; i < block->header.count; i++) {
+            uint32_t delta = 0;
+            for (int shift = 0;; shift += 7) {
+                unsigned char byte = *in++;
+                delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+                if (byte < 0x80) break;
+            }
+            value += delta;
+            values.push_back(static_cast<int>(value));
+        }
+        unpin_page(page, false);
+    }
+
+    // values[begin, end)编码后的字节数
+    static int encoded_size(const vector<int>& values, size_t begin, size_t end) {
+        int bytes = 0;
+        for (size_t i = begin; i < end; i++) {
+            bytes += varint_size(static_cast<uint32_t>(values[i] - (i > begin ? values[i - 1] : 0)));
+        }
+        return bytes;
+    }
+
+    // 把values[begin, end)写入块（调用方保证放得下）
+    void write_block(int page, const vector<int>& values, size_t begin, size_t end) {
+        BlockPage* block = reinterpret_cast<BlockPage*>(pin_page(page, false));
+        memset(block, 0, POSTING_PAGE_SIZE);
+        unsigned char* out = block->data;
+        for (size_t i = begin; i < end; i++) {
+            out = put_varint(out, static_cast<uint32_t>(values[i] - (i > begin ? values[i - 1] : 0)));
+        }
+        block->header.count = static_cast<int>(end - begin);
+        block->header.used = static_cast<int>(out - block->data);
+        unpin_page(page, true);
+    }
+
+    // 读入首页为head的跳表
+    void load_skips(int head, SkipList& list) {
+        list.entries.clear();
+        list.pages.clear();
+        for (int page = head; page != -1;) {
+            const SkipPage* skip = reinterpret_cast<const SkipPage*>(pin_page(page));
+            if (page == head) {
+                list.count = skip->header.count;
+            }
+            list.entries.insert(list.entries.end(), skip->entries, skip->entries + skip->header.entry_count);
+            list.pages.push_back(page);
+            int next = skip->header.next;
+            unpin_page(page, false);
+            page = next;
+        }
+    }
+
+    // 写回跳表，页数随块数增减（首页保留）
+    void write_skips(SkipList& list) {
+        int need = max(1, ((int)list.entries.size() + SKIPS_PER_PAGE - 1) / SKIPS_PER_PAGE);
+        while ((int)list.pages.size() < need) {
+            list.pages.push_back(allocate_page());
+        }
+        while ((int)list.pages.size() > need) {
+            free_page(list.pages.back());
+            list.pages.pop_back();
+        }
+        for (int i = 0; i < need; i++) {
+            SkipPage* skip = reinterpret_cast<SkipPage*>(pin_page(list.pages[i], false));
+            memset(skip, 0, POSTING_PAGE_SIZE);
+            int begin = i * SKIPS_PER_PAGE;
+            int rest = (int)list.entries.size() - begin;
+            skip->header.count = i == 0 ? list.count : 0;
+            skip->header.entry_count = rest < SKIPS_PER_PAGE ? rest : SKIPS_PER_PAGE;
+            skip->header.next = i + 1 < need ? list.pages[i + 1] : -1;
+            memcpy(skip->entries, list.entries.data() + begin, skip->header.entry_count * sizeof(SkipEntry));
+            unpin_page(list.pages[i], true);
+        }
+    }
+
+    // value所在（或应插入）的块：第一个位置不大于value的最后一块，都大于时为第0块
+    static int block_for(const SkipList& list, int value) {
+        int left = 1, right = (int)list.entries.size();
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            if (list.entries[mid].first <= value) {
+                left = mid + 1;
+            }
+            else {
+                right = mid;
+            }
+        }
+        return left - 1;
+    }
+
+    // 为新键写入一串有序位置：依次写满各块，最后写跳表并登记到字典
+    void create_list(const char* index, const vector<int>& values) {
+        SkipList list;
+        list.count = (int)values.size();
+        list.pages.push_back(allocate_page());
+        size_t begin = 0;
+        while (begin < values.size()) {
+            size_t end = begin;
+            int bytes = 0;
+            while (end < values.size()) {
+                int next = varint_size(static_cast<uint32_t>(values[end] - (end > begin ? values[end - 1] : 0)));
+                if (bytes + next > BLOCK_BYTES) break;
+                bytes += next;
+                end++;
+            }
+            int page = allocate_page();
+            write_block(page, values, begin, end);
+            list.entries.push_back(SkipEntry{values[begin], page});
+            begin = end;
+        }
+        write_skips(list);
+        dictionary.insert(index, list.pages[0]);
+    }
+
+    void init_new_file() {
+        posting_header.page_count = 1;
+        posting_header.free_page = -1;
+        write_posting_header();
+    }
+
+    // (键, 位置)的比较，用于批量装载前的排序
+    static bool pair_less(const pair<string, int>& a, const pair<string, int>& b) {
+        int cmp = strcmp(a.first.c_str(), b.first.c_str());
+        return cmp < 0 || (cmp == 0 && a.second < b.second);
+    }
+
+public:
+    // dictionary_name为键字典文件，postings_name为倒排表文件
+    InvertedIndex(const string& dictionary_name, const string& postings_name)
+        : dictionary(dictionary_name), filename(postings_name) {
+        data_file.open(filename);
+        bool is_new = data_file.size() < (long long)sizeof(PostingHeader);
+        pool->attach(this);
+        journal->attach(this);
+        if (is_new) {
+            init_new_file();
+        }
+        else {
+            const char* page = pin_page(0);
+            memcpy(&posting_header, page, sizeof(PostingHeader));
+            unpin_page(0, false);
+        }
+    }
+
+    ~InvertedIndex() {
+        // 写回缓冲池中属于本文件的脏页
+        pool->detach(this);
+        journal->detach(this);
+        data_file.close();
+    }
+
+    void read_page(int page, char* data, int size) override {
+        data_file.read(static_cast<long long>(page) * POSTING_PAGE_SIZE, data, size);
+    }
+
+    void write_page(int page, const char* data, int size) override {
+        data_file.write(static_cast<long long>(page) * POSTING_PAGE_SIZE, data, size);
+    }
+
+    void sync() override {
+        data_file.sync();
+    }
+
+    bool journaled() const override {
+        return true;
+    }
+
+    // 把本次指令修改过的页面交给日志（字典是独立的日志客户）
+    void prepare_commit() override {
+        pool->collect(this, [this](int page, int begin, const char* data, int size) {
+            journal->record(filename, static_cast<long long>(page) * POSTING_PAGE_SIZE + begin, data, size);
+        });
+    }
+
+    // 日志落盘后，交出的页面才可以被淘汰写回
+    void committed() override {
+        pool->logged(this);
+    }
+
+    void checkpoint() override {
+        pool->flush(this);
+    }
+
+    void flush() {
+        dictionary.flush();
+        checkpoint();
+    }
+
+    // 键的个数
+    int size() const {
+        return dictionary.size();
+    }
+
+    // 插入操作，(index, value)已存在时不插入
+    void insert(const char* index, int value) {
+        vector<int> heads = dictionary.find(index);
+        if (heads.empty()) {
+            create_list(index, vector<int>(1, value));
+            return;
+        }
+
+        SkipList list;
+        load_skips(heads[0], list);
+        int i = block_for(list, value);
+        vector<int> values;
+        read_block(list.entries[i].page, values);
+        auto it = lower_bound(values.begin(), values.end(), value);
+        if (it != values.end() && *it == value) {
+            return;
+        }
+        values.insert(it, value);
+
+        if (encoded_size(values, 0, values.size()) <= BLOCK_BYTES) {
+            write_block(list.entries[i].page, values, 0, values.size());
+        }
+        else {
+            // 按个数对半分裂，新块接在其后
+            size_t half = values.size() / 2;
+            int page = allocate_page();
+            write_block(list.entries[i].page, values, 0, half);
+            write_block(page, values, half, values.size());
+            list.entries.insert(list.entries.begin() + i + 1, SkipEntry{values[half], page});
+        }
+        list.entries[i].first = values.front();
+        list.count++;
+        write_skips(list);
+    }
+
+    // 删除操作
+    void remove(const char* index, int value) {
+        vector<int> heads = dictionary.find(index);
+        if (heads.empty()) {
+            return;
+        }
+
+        SkipList list;
+        load_skips(heads[0], list);
+        int i = block_for(list, value);
+        vector<int> values;
+        read_block(list.entries[i].page, values);
+        auto it = lower_bound(values.begin(), values.end(), value);
+        if (it == values.end() || *it != value) {
+            return;
+        }
+        values.erase(it);
+        list.count--;
+
+        if (!values.empty()) {
+            write_block(list.entries[i].page, values, 0, values.size());
+            list.entries[i].first = values.front();
+            write_skips(list);
+            return;
+        }
+
+        // 块变空：释放块，键没有位置时连同跳表一起删除
+        free_page(list.entries[i].page);
+        list.entries.erase(list.entries.begin() + i);
+        if (!list.entries.empty()) {
+            write_skips(list);
+            return;
+        }
+        for (int page : list.pages) {
+            free_page(page);
+        }
+        dictionary.remove(index, heads[0]);
+    }
+
+    // 查找操作：键的全部位置，升序
+    vector<int> find(const char* index) {
+        vector<int> values;
+        vector<int> heads = dictionary.find(index);
+        if (heads.empty()) {
+            return values;
+        }
+        SkipList list;
+        load_skips(heads[0], list);
+        values.reserve(list.count);
+        for (const SkipEntry& entry : list.entries) {
+            read_block(entry.page, values);
+        }
+        return values;
+    }
+
+    // 批量装载(键, 位置)，元素类型为pair<string, int>
+    // 字典中还没有的键整块写入，已有的键逐条插入
+    template<typename Iterator>
+    void bulk_load(Iterator begin, Iterator end) {
+        vector<pair<string, int>> sorted(begin, end);
+        sort(sorted.begin(), sorted.end(), pair_less);
+        size_t i = 0;
+        while (i < sorted.size()) {
+            size_t j = i;
+            vector<int> values;
+            for (; j < sorted.size() && sorted[j].first == sorted[i].first; j++) {
+                if (values.empty() || values.back() != sorted[j].second) {
+                    values.push_back(sorted[j].second);
+                }
+            }
+            const char* index = sorted[i].first.c_str();
+            if (dictionary.find(index).empty()) {
+                create_list(index, values);
+            }
+            else {
+                for (int value : values) {
+                    insert(index, value);
+                }
+            }
+            i = j;
+        }
+    }
+};
+
+#endif //BOOKSTORE_2025_INVERTEDINDEX_H
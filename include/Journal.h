@@ -0,0 +1,71 @@
+#ifndef BOOKSTORE_2025_JOURNAL_H
+#define BOOKSTORE_2025_JOURNAL_H
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "PositionalFile.h"
+
+// 参与日志提交的存储结构（延迟写回的文件）
+class JournalClient {
+public:
+    virtual ~JournalClient() = default;
+
+    // 提交前调用：把自上次提交以来修改过、尚未写回原位的内容交给record
+    virtual void prepare_commit() = 0;
+
+    // 提交后调用：本次交出的修改已在日志中落盘
+    virtual void committed() {}
+
+    // 检查点：把所有已提交的修改写回原位并刷到磁盘，之后日志会被清空
+    virtual void checkpoint() = 0;
+};
+
+const size_t JOURNAL_CHECKPOINT_SIZE = 8 << 20;  // 日志超过该大小时做检查点
+
+// 预写日志：一条指令内所有文件的修改合并为一条记录，提交时只追加并fdatasync一次
+// 各文件的原位写回推迟到缓冲池淘汰或检查点；启动时重放已提交的记录
+// 记录格式：[magic][payload长度][payload][CRC32C校验和]
+// payload由若干条(文件名, 偏移, 长度, 实际保存长度, 数据)组成，末尾的0字节不保存；
+// 缓冲池中的页面只交出变化的字节区间
+class Journal {
+private:
+    std::string journal_name;          // 日志文件名
+    PositionalFile journal_file;       // 日志文件
+    std::vector<char> pending;         // 当前事务的payload
+    std::vector<JournalClient*> clients;   // 延迟写回的文件
+    size_t journal_size = 0;           // 日志文件当前大小
+
+    void open_journal(bool truncate);
+
+    // 把一条记录中的修改写到各文件原位，files为已打开的文件
+    static void apply(const char* payload, size_t length,
+                      std::map<std::string, std::unique_ptr<PositionalFile>>& files);
+
+public:
+    explicit Journal(const std::string& journal_name = "journal.dat");
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // 全部文件共用的日志
+    static Journal& shared();
+
+    // 启动时调用：重放日志中完整的记录，然后清空日志
+    void recover();
+
+    void attach(JournalClient* client);
+    void detach(JournalClient* client);
+
+    // 记录一次写入：文件file的offset处写入size字节
+    void record(const std::string& file, long long offset, const char* data, int size);
+
+    // 提交当前事务：写入一条日志记录并刷到磁盘；日志过大时做检查点
+    void commit();
+
+    // 让所有文件把修改写回原位，然后清空日志
+    void checkpoint();
+};
+
+#endif //BOOKSTORE_2025_JOURNAL_H
@@ -0,0 +1,38 @@
+#ifndef BOOKSTORE_2025_MAPPEDFILE_H
+#define BOOKSTORE_2025_MAPPEDFILE_H
+#include <cstddef>
+#include <string>
+
+// 整个文件映射到内存（MAP_SHARED），通过ftruncate/mremap扩展，msync刷盘
+class MappedFile {
+private:
+    int fd = -1;              // 文件描述符
+    char* base = nullptr;     // 映射起始地址
+    size_t length = 0;        // 映射长度（等于文件大小）
+
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 打开文件，不存在时创建；返回是否成功
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return fd != -1; }
+    size_t size() const { return length; }
+    char* data() const { return base; }
+
+    // 将文件扩展（或截断）到new_size字节并重新映射，原有指针随之失效
+    void resize(size_t new_size);
+
+    // 保证文件至少有need字节，不足时按倍增扩展
+    void reserve(size_t need);
+
+    // 将映射中的修改同步到磁盘
+    void sync();
+};
+
+#endif //BOOKSTORE_2025_MAPPEDFILE_H
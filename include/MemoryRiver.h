@@ -1,31 +1,129 @@
 #ifndef BOOKSTORE_2025_MEMORYRIVER_H
 #define BOOKSTORE_2025_MEMORYRIVER_H
 
-#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <vector>
+#include "Journal.h"
+#include "PositionalFile.h"
+#include "RecordCache.h"
 
 using std::string;
-using std::fstream;
-using std::ifstream;
-using std::ofstream;
 
+// 写入先留在内存，提交时记入预写日志，检查点时才写回文件原位
+// 文件在initialise时打开并一直保持打开，按偏移读写（pread/pwrite）
+// 可选的记录缓存按位置保存最近读写过的对象，命中时不读文件；写入时同步更新缓存
+// 位置索引是64位的字节偏移，文件可以超过2GB
+// 可选的空闲链表：Delete把槽位清零后挂入链表，write优先取链表中的槽位；表头存在指定的info中，
+// 链表的下一项存在空闲槽位的开头sizeof(long long)个字节（0表示链表结束）
 template<class T, int info_len = 2>
-class MemoryRiver {
+class MemoryRiver : public JournalClient {
 private:
-    fstream file;  // 文件流对象
+    PositionalFile file;  // 数据文件
     string file_name;  // 文件名
     int sizeofT = sizeof(T);  // 对象T的大小
+    static constexpr long long info_end = info_len * sizeof(double);  // info区的长度，即第一个对象的位置
+
+    std::map<long long, std::vector<char>> pending;  // 偏移 -> 尚未写回的数据
+    std::set<long long> unlogged;  // 自上次提交以来修改过的偏移
+    long long end_offset = 0;  // 包含未写回数据在内的文件长度
+    bool attached = false;  // 是否已加入日志
+    RecordCache<T> cache;  // 记录缓存，默认容量为0（不缓存）
+    int free_info = 0;  // 保存空闲链表表头的info（1_base），0表示不复用空间
+    long long free_head = 0;  // 空闲链表表头，0表示为空
+
+    // 增量压缩的状态
+    std::vector<std::pair<long long, long long>> moves;  // 尚未完成的搬移(原位置, 新位置)
+    long long compact_from = -1;  // 开始压缩时的文件长度，-1表示未在压缩
+    long long compact_to = 0;  // 压缩完成后的文件长度
+    bool truncate_pending = false;  // 检查点时把文件截短到end_offset
+
+    // 暂存一次写入
+    void stage(long long offset, const char* data, int size) {
+        if (size == sizeofT && offset >= info_end) {
+            T t;
+            std::memcpy(&t, data, sizeof(T));
+            cache.put(offset, t);
+        }
+        pending[offset].assign(data, data + size);
+        unlogged.insert(offset);
+        end_offset = std::max(end_offset, offset + size);
+        attach();
+    }
+
+    // 读出[offset, offset + size)，包括尚未写回的数据
+    void read_raw(long long offset, char* data, int size) {
+        file.read(offset, data, size);
+        overlay(offset, data, size);
+    }
+
+    // 空闲槽位中保存的下一项
+    long long next_free(long long slot) {
+        long long next = 0;
+        read_raw(slot, reinterpret_cast<char*>(&next), sizeof(long long));
+        return next;
+    }
+
+    // 更新空闲链表表头，随本条指令提交
+    void set_free_head(long long head) {
+        free_head = head;
+        write_info(static_cast<double>(head), free_info);
+    }
+
+    // 加入日志，之后随日志提交和检查点
+    void attach() {
+        if (!attached) {
+            Journal::shared().attach(this);
+            attached = true;
+        }
+    }
+
+    // 用尚未写回的数据覆盖从文件读出的[offset, offset + size)
+    void overlay(long long offset, char* data, int size) {
+        long long longest = std::max(sizeofT, static_cast<int>(sizeof(double)));
+        for (auto it = pending.lower_bound(offset - longest + 1);
+             it != pending.end() && it->first < offset + size; ++it) {
+            long long lo = std::max(offset, it->first);
+            long long hi = std::min(offset + size, it->first + static_cast<long long>(it->second.size()));
+            if (lo < hi) {
+                std::memcpy(data + (lo - offset), it->second.data() + (lo - it->first), hi - lo);
+            }
+        }
+    }
 public:
     MemoryRiver() = default;
 
     MemoryRiver(const string& file_name) : file_name(file_name) {}
 
+    //设置记录缓存的容量（记录个数），0表示不缓存
+    void set_cache_capacity(size_t records) {
+        cache.set_capacity(records);
+    }
+
+    //用第n个info（1_base）保存空闲链表表头，此后Delete的槽位由write重新使用；在initialise之后调用
+    //该info不能再作他用（从未写过的info为0，即空链表）
+    void reuse_space(int n) {
+        static_assert(sizeof(T) >= sizeof(long long), "record too small for the free list");
+        if (n < 1 || n > info_len) return;
+        free_info = n;
+        double head = 0;
+        get_info(head, n);
+        free_head = static_cast<long long>(head);
+    }
+
     void initialise(string FN = "") {
         if (FN != "") file_name = FN;
-        file.open(file_name, std::ios::out | fstream::binary);  // 创建文件并向文件中写入
-        double tmp = 0.0;
-        for (int i = 0; i < info_len; ++i)
-            file.write(reinterpret_cast<char *>(&tmp), sizeof(double));
-        file.close();
+        // 文件已存在时保留原有数据，否则创建文件并写入清零的info
+        file.open(file_name);
+        end_offset = file.size();
+        if (end_offset > 0) {
+            return;
+        }
+        end_offset = info_end;
+        std::vector<char> info(end_offset, 0);
+        file.write(0, info.data(), info.size());
     }
 
     //读出第n个double的值赋给tmp，1_base
@@ -33,20 +131,12 @@ public:
         if (n > info_len) return;
         /* your code here */
         if (n < 1) return;
-        file.open(file_name, fstream::in | fstream::binary);
         // 如果没有成功打开
-        if (!file) {
+        if (!file.is_open()) {
             return;
         }
-
-        // 将指针定位到第n个double的位置
-        file.seekg((n - 1) * sizeof(double));
-
-        // 读取
-        file.read(reinterpret_cast<char *>(&tmp), sizeof(double));
-
-        // 关闭
-        file.close();
+        file.read((n - 1) * sizeof(double), reinterpret_cast<char *>(&tmp), sizeof(double));
+        overlay((n - 1) * sizeof(double), reinterpret_cast<char *>(&tmp), sizeof(double));
     }
 
     //将tmp写入第n个double的位置，1_base
@@ -54,80 +144,202 @@ public:
         if (n > info_len) return;
         /* your code here */
         if (n < 1) return;
-        file.open(file_name, fstream::in | fstream::out | fstream::binary);
-        // 如果没有成功打开
-        if (!file) {
-            return;
-        }
-
-        // 将指针定位到第n个double的位置
-        file.seekp((n - 1) * sizeof(double));
-
-        // 写入
-        file.write(reinterpret_cast<char *>(&tmp), sizeof(double));
-
-        // 关闭
-        file.close();
+        stage((n - 1) * sizeof(double), reinterpret_cast<char *>(&tmp), sizeof(double));
     }
 
     //在文件合适位置写入类对象t，并返回写入的位置索引index
     //位置索引意味着当输入正确的位置索引index，在以下三个函数中都能顺利的找到目标对象进行操作
     //位置索引index可以取为对象写入的起始位置
-    int write(T &t) {
+    long long write(T &t) {
         /* your code here */
-        file.open(file_name, fstream::in | fstream::out | fstream::binary);
-
-        // 写指针定位到末尾
-        file.seekp(0, fstream::end);
-        int p = file.tellp();
-
-        // 写入
-        file.write(reinterpret_cast<char *>(&t), sizeof(T));
-
-        // 关闭
-        file.close();
+        // 优先使用空闲槽位，否则追加到文件末尾（包括尚未写回的数据）
+        long long p = end_offset;
+        if (free_head != 0) {
+            p = free_head;
+            set_free_head(next_free(p));
+        }
+        stage(p, reinterpret_cast<char *>(&t), sizeof(T));
         return p;
     }
 
     //用t的值更新位置索引index对应的对象，保证调用的index都是由write函数产生
-    void update(T &t, const int index) {
+    void update(T &t, const long long index) {
         /* your code here */
-        if (index < info_len * sizeof(double)) return;  // 改为sizeof(double)
+        if (index < info_end) return;  // 改为sizeof(double)
+        stage(index, reinterpret_cast<char *>(&t), sizeof(T));
+    }
 
-        file.open(file_name, fstream::in | fstream::out | fstream::binary);
+    //读出位置索引index对应的T对象的值并赋值给t，保证调用的index都是由write函数产生
+    void read(T &t, const long long index) {
+        /* your code here */
+        if (index < info_end) return;  // 改为sizeof(double)
+        if (cache.get(index, t)) return;
+        file.read(index, reinterpret_cast<char *>(&t), sizeof(T));
+        overlay(index, reinterpret_cast<char *>(&t), sizeof(T));
+        cache.put(index, t);
+    }
 
-        // 定位写入指针
-        file.seekp(index);
+    //批量读出indices中各位置的对象，ts[i]对应indices[i]
+    //按位置顺序读取，位置相邻的对象合并为一次读
+    //不经过记录缓存：缓存命中会把连续的一段拆成多次读，批量读出的对象也不放入缓存，以免整表扫描把常用记录挤出
+    void read_many(const std::vector<long long>& indices, std::vector<T>& ts) {
+        ts.resize(indices.size());
+        std::vector<size_t> order;
+        order.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (indices[i] >= info_end) order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&indices](size_t a, size_t b) {
+            return indices[a] < indices[b];
+        });
 
-        // 写入
-        file.write(reinterpret_cast<char *>(&t), sizeof(T));
+        std::vector<char> buffer;
+        for (size_t begin = 0, end; begin < order.size(); begin = end) {
+            // 找出从begin开始位置连续的一段（重复的位置各读一次）
+            end = begin + 1;
+            while (end < order.size() && indices[order[end]] == indices[order[end - 1]] + sizeofT) {
+                ++end;
+            }
+            buffer.resize((end - begin) * sizeofT);
+            file.read(indices[order[begin]], buffer.data(), buffer.size());
+            for (size_t k = begin; k < end; ++k) {
+                std::memcpy(&ts[order[k]], buffer.data() + (k - begin) * sizeofT, sizeof(T));
+            }
+        }
+        for (size_t i : order) {
+            overlay(indices[i], reinterpret_cast<char *>(&ts[i]), sizeof(T));
+        }
+    }
 
-        // 关闭
-        file.close();
+    //批量更新：用ts[i]的值更新位置索引indices[i]对应的对象，语义同update
+    void write_many(const std::vector<long long>& indices, const std::vector<T>& ts) {
+        for (size_t i = 0; i < indices.size() && i < ts.size(); ++i) {
+            if (indices[i] < info_end) continue;
+            stage(indices[i], reinterpret_cast<const char *>(&ts[i]), sizeof(T));
+        }
     }
 
-    //读出位置索引index对应的T对象的值并赋值给t，保证调用的index都是由write函数产生
-    void read(T &t, const int index) {
-        /* your code here */
-        if (index < info_len * sizeof(double)) return;  // 改为sizeof(double)
-        file.open(file_name, fstream::in | fstream::binary);
+    //文件长度（包括尚未写回的数据），最后一个对象之后的位置
+    long long length() const {
+        return end_offset;
+    }
+
+    //删除位置索引index对应的对象，保证调用的index都是由write函数产生
+    //启用空闲链表时槽位清零后挂入链表；压缩进行中时取消该对象尚未完成的搬移，槽位留到下次压缩回收
+    //（压缩会搬进空位、截掉末尾，此时复用槽位可能与搬移冲突）
+    void Delete(long long index) {
+        if (index < info_end) return;
+        if (compacting()) {
+            moves.erase(std::remove_if(moves.begin(), moves.end(), [index](const std::pair<long long, long long>& move) {
+                return move.first == index;
+            }), moves.end());
+        }
+        else if (free_info != 0) {
+            std::vector<char> slot(sizeofT, 0);
+            std::memcpy(slot.data(), &free_head, sizeof(long long));
+            stage(index, slot.data(), sizeofT);
+            set_free_head(index);
+        }
+        cache.erase(index);
+    }
 
-        file.seekg(index);
+    //对象槽位数（包括已删除但尚未回收的）
+    int capacity() const {
+        return static_cast<int>((end_offset - info_end) / sizeofT);
+    }
 
-        // 读入
-        file.read(reinterpret_cast<char *>(&t), sizeof(T));
+    //空位超过槽位数的1/4（且不少于4个）时值得压缩，live为存活对象数
+    bool sparse(int live) const {
+        return (capacity() - live) * 4 > capacity() + 16;
+    }
 
-        // 关闭
-        file.close();
+    //开始增量压缩：live为全部存活对象的位置，其余槽位视为空位
+    //压缩后的文件末尾之外的存活对象将依次搬进前面的空位
+    //空闲链表中的槽位都不在live中，同样由压缩回收，因此清空链表
+    void begin_compact(std::vector<long long> live) {
+        if (free_head != 0) {
+            set_free_head(0);
+        }
+        std::sort(live.begin(), live.end());
+        long long base = info_end;
+        compact_from = end_offset;
+        compact_to = base + static_cast<long long>(live.size()) * sizeofT;
+        moves.clear();
+        auto mover = std::lower_bound(live.begin(), live.end(), compact_to);
+        auto kept = live.begin();
+        for (long long pos = base; pos < compact_to && mover != live.end(); pos += sizeofT) {
+            if (kept != live.end() && *kept == pos) {
+                ++kept;
+                continue;
+            }
+            moves.emplace_back(*mover++, pos);
+        }
     }
 
-    //删除位置索引index对应的对象(不涉及空间回收时，可忽略此函数)，保证调用的index都是由write函数产生
-    void Delete(int index) {
+    bool compacting() const {
+        return compact_from != -1;
+    }
+
+    //压缩一步：至多搬移budget个对象，每搬一个调用moved(原位置, 新位置)由调用方更新索引
+    //全部搬完后返回true；压缩期间没有追加新对象时截掉文件末尾
+    template<typename Moved>
+    bool compact(int budget, Moved moved) {
+        if (!compacting()) return true;
+        // 本步要搬的对象一次读出、一次写入新位置，再逐个通知调用方
+        std::vector<long long> from, to;
+        for (; budget > 0 && !moves.empty(); --budget) {
+            from.push_back(moves.back().first);
+            to.push_back(moves.back().second);
+            moves.pop_back();
+        }
+        std::vector<T> ts;
+        read_many(from, ts);
+        write_many(to, ts);
+        for (size_t i = 0; i < from.size(); ++i) {
+            moved(from[i], to[i]);
+        }
+        if (!moves.empty()) return false;
+
+        if (end_offset == compact_from) {
+            // 末尾的对象都已搬走，丢弃其尚未写回的数据
+            pending.erase(pending.lower_bound(compact_to), pending.end());
+            unlogged.erase(unlogged.lower_bound(compact_to), unlogged.end());
+            cache.erase_from(compact_to);
+            end_offset = compact_to;
+            truncate_pending = true;
+            attach();
+        }
+        compact_from = -1;
+        return true;
+    }
+
+    // 把本次指令的写入交给日志
+    void prepare_commit() override {
+        for (long long offset : unlogged) {
+            const std::vector<char>& data = pending[offset];
+            Journal::shared().record(file_name, offset, data.data(), data.size());
+        }
+        unlogged.clear();
+    }
+
+    // 检查点：把暂存的写入全部写回原位
+    void checkpoint() override {
+        for (const auto& item : pending) {
+            file.write(item.first, item.second.data(), item.second.size());
+        }
+        file.sync();  // 日志随后会被清空，写回的内容须先落盘
+        pending.clear();
+        if (truncate_pending) {
+            // 压缩完成后截掉文件末尾已搬走的对象
+            file.truncate(end_offset);
+            truncate_pending = false;
+        }
     }
 
     ~MemoryRiver() {
-        if (file.is_open()) {
-            file.close();
+        if (attached) {
+            checkpoint();
+            Journal::shared().detach(this);
         }
     }
 };
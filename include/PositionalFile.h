@@ -0,0 +1,40 @@
+#ifndef BOOKSTORE_2025_POSITIONALFILE_H
+#define BOOKSTORE_2025_POSITIONALFILE_H
+#include <cstddef>
+#include <string>
+
+// 按偏移读写的文件（pread/pwrite），不维护读写位置，可被多个线程同时读写
+class PositionalFile {
+private:
+    int fd = -1;              // 文件描述符
+
+public:
+    PositionalFile() = default;
+    ~PositionalFile();
+
+    PositionalFile(const PositionalFile&) = delete;
+    PositionalFile& operator=(const PositionalFile&) = delete;
+
+    // 打开文件，不存在时创建；返回是否成功
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return fd != -1; }
+
+    // 当前文件大小
+    long long size() const;
+
+    // 从offset处读取size字节，超出文件末尾的部分填0
+    void read(long long offset, char* data, size_t size) const;
+
+    // 向offset处写入size字节
+    void write(long long offset, const char* data, size_t size);
+
+    // 把文件截短到size字节（不会加长文件）
+    void truncate(long long size);
+
+    // 把已写入的内容刷到磁盘（fdatasync）
+    void sync();
+};
+
+#endif //BOOKSTORE_2025_POSITIONALFILE_H
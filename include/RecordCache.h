@@ -0,0 +1,88 @@
+#ifndef BOOKSTORE_2025_RECORDCACHE_H
+#define BOOKSTORE_2025_RECORDCACHE_H
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// 按记录位置缓存对象的LRU缓存，容量以记录个数计，为0时不缓存
+// 只保存对象的最新值，写回文件由使用者负责（MemoryRiver在写入时同步更新缓存）
+template<class T>
+class RecordCache {
+private:
+    typedef std::list<std::pair<long long, T>> Entries;
+
+    Entries entries;      // 表头为最近使用的记录
+    std::unordered_map<long long, typename Entries::iterator> table;  // 位置 -> 记录
+    size_t capacity = 0;  // 最多缓存的记录数
+
+    // 淘汰最久未使用的记录，直到不超过容量
+    void evict() {
+        while (entries.size() > capacity) {
+            table.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+public:
+    explicit RecordCache(size_t capacity = 0) : capacity(capacity) {}
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    void set_capacity(size_t records) {
+        capacity = records;
+        evict();
+    }
+
+    // 命中时取出pos处的对象并标记为最近使用
+    bool get(long long pos, T& t) {
+        auto it = table.find(pos);
+        if (it == table.end()) {
+            return false;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        t = it->second->second;
+        return true;
+    }
+
+    // 放入或更新pos处的对象
+    void put(long long pos, const T& t) {
+        if (capacity == 0) {
+            return;
+        }
+        auto it = table.find(pos);
+        if (it != table.end()) {
+            it->second->second = t;
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+        entries.emplace_front(pos, t);
+        table[pos] = entries.begin();
+        evict();
+    }
+
+    void erase(long long pos) {
+        auto it = table.find(pos);
+        if (it != table.end()) {
+            entries.erase(it->second);
+            table.erase(it);
+        }
+    }
+
+    // 丢弃位置不小于pos的全部记录（文件截短时）
+    void erase_from(long long pos) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->first >= pos) {
+                table.erase(it->first);
+                it = entries.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+};
+
+#endif //BOOKSTORE_2025_RECORDCACHE_H
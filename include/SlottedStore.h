@@ -0,0 +1,112 @@
+#ifndef BOOKSTORE_2025_SLOTTEDSTORE_H
+#define BOOKSTORE_2025_SLOTTEDSTORE_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BufferPool.h"
+#include "Journal.h"
+#include "MemoryRiver.h"
+#include "PositionalFile.h"
+
+const int SLOTTED_PAGE_SIZE = 4096;   // 数据页大小
+
+// 变长记录存储：记录按编号（从1开始连续分配）访问，编号在记录更新、搬到别的页后保持不变
+// 数据文件按页组织（slotted page）：页头之后是槽位数组，记录从页尾向前存放，槽位给出记录在页内的偏移和长度
+// 编号 -> (页号, 槽位号)的对照表是一个定长记录的MemoryRiver，记录在页内移动只改槽位，换页时才改对照表
+// 更新时页内放得下就留在原页（必要时整理页内空间），否则移到最后一页；新记录也追加到最后一页
+// 数据页经共享缓冲池读写并经预写日志提交；第0页为文件头
+class SlottedStore : public PageOwner, public JournalClient {
+private:
+    // 文件头（第0页）
+    struct StoreHeader {
+        int page_count;       // 已分配页数（包括文件头）
+        int record_count;     // 已分配的记录编号数
+        int last_page;        // 新记录写入的页，0表示还没有数据页
+    };
+
+    // 数据页页头
+    struct PageHeader {
+        uint16_t slot_count;  // 槽位数（包括空槽位）
+        uint16_t data_start;  // 记录区起点，[data_start, SLOTTED_PAGE_SIZE)
+    };
+
+    // 槽位：offset为0表示空槽位
+    struct Slot {
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    // 对照表项
+    struct RecordSlot {
+        int page;
+        int slot;
+    };
+
+    PositionalFile data_file;     // 数据文件
+    std::string filename;         // 数据文件名
+    MemoryRiver<RecordSlot> slots;  // 编号 -> (页号, 槽位号)
+    BufferPool* pool = &BufferPool::shared();  // 页面缓冲池
+    Journal* journal = &Journal::shared();     // 预写日志
+    StoreHeader store_header;     // 文件头缓存
+
+    char* pin_page(int page, bool load = true);
+    void unpin_page(int page, bool dirty);
+    void write_store_header();
+
+    // 编号id在对照表文件中的位置
+    static long long slot_pos(int id);
+
+    // 页内还能放下的字节数（整理后），不计except号槽位中的记录
+    static int free_bytes(const char* page, int except = -1);
+
+    // 把页内的记录紧挨着移到页尾，不保留except号槽位中的记录
+    static void compact_page(char* page, int except = -1);
+
+    // 把记录放进页面（调用方保证放得下），slot为-1时取一个空槽位或新槽位；返回槽位号
+    static int place(char* page, const std::string& record, int slot);
+
+    // 把记录追加到最后一页，放不下时分配新页；返回位置
+    RecordSlot append(const std::string& record);
+
+public:
+    // page_name为数据文件，slot_name为对照表文件
+    SlottedStore(const std::string& page_name, const std::string& slot_name);
+    ~SlottedStore();
+
+    SlottedStore(const SlottedStore&) = delete;
+    SlottedStore& operator=(const SlottedStore&) = delete;
+
+    // 一条记录的最大长度
+    static int max_record();
+
+    // 已分配的记录编号数，编号为1 ~ size()
+    int size() const {
+        return store_header.record_count;
+    }
+
+    // 写入新记录，返回其编号
+    int insert(const std::string& record);
+
+    // 用record替换编号id的记录
+    void update(int id, const std::string& record);
+
+    void read(int id, std::string& record);
+
+    // 批量读出，records[i]对应ids[i]
+    void read_many(const std::vector<int>& ids, std::vector<std::string>& records);
+
+    void read_page(int page, char* data, int size) override;
+    void write_page(int page, const char* data, int size) override;
+    void sync() override;
+
+    bool journaled() const override {
+        return true;
+    }
+
+    // 把本次指令修改过的页面交给日志（对照表是独立的日志客户）
+    void prepare_commit() override;
+    void committed() override;
+    void checkpoint() override;
+};
+
+#endif //BOOKSTORE_2025_SLOTTEDSTORE_H
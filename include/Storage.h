@@ -2,26 +2,68 @@
 #define BOOKSTORE_2025_STORAGE_H
 #include <iostream>
 #include <fstream>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <set>
+#include <shared_mutex>
+#include <mutex>
+#include "BloomFilter.h"
+#include "BufferPool.h"
+#include "Journal.h"
+#include "MappedFile.h"
+#include "PositionalFile.h"
 
 using namespace std;
 
 // 常量定义
-const int BLOCK_SIZE = 512;         // 默认块大小
-const int MIN_BLOCK_SIZE = 64;      // 块合并阈值
-const int MAX_HEAD_RESERVE = 480000; // 为NodeHead预留空间
+const int BLOCK_SIZE = 512;         // 块容量按BLOCK_SIZE个未压缩条目计
+const int MIN_BLOCK_SIZE = 64;      // 块合并阈值（占BLOCK_SIZE的比例）
+const int RESTART_INTERVAL = 16;    // 块内每隔多少条目完整保存一次键
+const int INITIAL_HEAD_RESERVE = 16384; // 新文件为NodeHead预留的初始空间，用满后在数据区另辟更大的区域
+const int LEGACY_HEAD_RESERVE = 480000; // 旧格式（版本0）固定的NodeHead预留空间
+const int VACUUM_SLACK = 16;        // 空闲或不连续的块超过(总块数 + VACUUM_SLACK) / 4时开始整理
+const int BLOCKLIST_MAGIC = 0x4C4B4C42;  // 文件头标识"BLKL"；旧格式此处是第一个NodeHead的偏移量（-1或不超过预留空间）
+const int BLOCKLIST_VERSION = 2;    // 当前格式版本：64位偏移，NodeHead区域可增长
+
+// BlockList的存储后端：按偏移读写+缓冲池（经预写日志提交），或整个文件mmap（不记日志）
+enum class StorageMode {
+    STREAM,
+    MMAP
+};
 
-// 文件头结构 (32字节)
+// 文件头结构 (64字节)
+// NodeBody按编号存放在data_start + 编号 * NodeBody大小处；NodeHead区域起初紧接文件头，
+// 用满后整体搬到数据区末尾新分配的一段连续NodeBody位置中，容量翻倍
 struct FileHeader {
-    int first_head_offset;    // 第一个NodeHead的偏移量
-    int last_head_offset;     // 最后一个NodeHead的偏移量
-    int free_head_offset;     // 空闲NodeHead链表头
+    int magic;                    // BLOCKLIST_MAGIC
+    int version;                  // 格式版本
+    long long first_head_offset;  // 第一个NodeHead的偏移量
+    long long last_head_offset;   // 最后一个NodeHead的偏移量
+    long long free_head_offset;   // 空闲NodeHead链表头
+    long long head_start;         // NodeHead区域起始偏移
+    long long data_start;         // 0号NodeBody的偏移
+    int head_capacity;            // NodeHead区域能容纳的NodeHead数
+    int head_count;               // NodeHead区域已用的NodeHead数（含空闲链表中的）
+    int body_count;               // 已分配的NodeBody编号数（含空闲链表中的和NodeHead区域占用的）
+    int free_body;                // 空闲NodeBody链表头（编号），-1表示为空
+};
+
+// 旧格式（版本0）的文件头 (32字节)，NodeHead区域固定为其后的LEGACY_HEAD_RESERVE字节，
+// NodeBody依次放在预留区之后（第一个位置不用），仅用于升级
+struct LegacyFileHeader {
+    int first_head_offset;
+    int last_head_offset;
+    int free_head_offset;
     int count;                // 使用的NodeHead和NodeBody数量
-    int free_body_offset;     // 空闲NodeBody链表头
-    int padding[3];          // 填充
+    int free_body_offset;
+    int padding[3];
 };
 
 // 数据条目结构
@@ -31,83 +73,504 @@ struct KeyValue {
     TypeName value;                // 值
 };
 
-// NodeBody结构
+// NodeBody结构：有序条目前端编码后变长存放
+// 键的格式为[共享前缀长度][后缀长度][后缀]，与前一个键共享的前缀不再保存
+// 每RESTART_INTERVAL个条目设一个重启点（共享长度为0），每个重启区间先存各键，再存各值组成的数组，
+// 查找时只需读键，命中后按下标取值
+// 条目区之后依次是重启点偏移数组和重启点缩略键数组
+// 缩略键为键的前8字节按大端序组成的uint64_t，块内二分先比较缩略键，相等时才比较完整的键
 template<int INDEX_LEN, typename TypeName>
 struct NodeBody {
-    int next_free;            // 空闲链表指针
-    KeyValue<INDEX_LEN, TypeName> pairs[BLOCK_SIZE];       // 数据条目数组
+    int next_free;            // 空闲链表中下一个NodeBody的编号，-1表示结束
+    int pair_count;           // 条目数
+    int used;                 // 条目区已用字节数
+    int restart_count;        // 重启点数
+    char data[sizeof(KeyValue<INDEX_LEN, TypeName>) * BLOCK_SIZE];  // 条目区 + 重启点数组
+};
+
+// 旧格式（版本0）的NodeBody：定长的条目数组，仅用于升级
+template<int INDEX_LEN, typename TypeName>
+struct PlainNodeBody {
+    int next_free;
+    KeyValue<INDEX_LEN, TypeName> pairs[BLOCK_SIZE];
 };
 
 // NodeHead结构
 template<int INDEX_LEN>
 struct NodeHead {
-    int prev_offset;          // 前一个NodeHead的偏移量
-    int next_offset;          // 下一个NodeHead的偏移量
-    int body_offset;          // 对应NodeBody在文件中的偏移量
+    long long prev_offset;    // 前一个NodeHead的偏移量
+    long long next_offset;    // 下一个NodeHead的偏移量
+    long long body_offset;    // 对应NodeBody在文件中的偏移量
     int pair_count;           // 当前块中存储的数据数量
     char min_index[INDEX_LEN];    // 当前块中最小index
     char max_index[INDEX_LEN];    // 当前块中最大index
 };
 
+// 旧格式（版本0）的NodeHead，仅用于升级
+template<int INDEX_LEN>
+struct LegacyNodeHead {
+    int prev_offset;
+    int next_offset;
+    int body_offset;
+    int pair_count;
+    char min_index[INDEX_LEN];
+    char max_index[INDEX_LEN];
+};
+
+// 内存块目录项（按链表顺序排列，用于二分定位块）
+template<int INDEX_LEN>
+struct BlockEntry {
+    long long head_offset;    // NodeHead在文件中的偏移量
+    long long body_offset;    // 对应NodeBody在文件中的偏移量
+    int pair_count;           // 当前块中存储的数据数量
+    char min_index[INDEX_LEN];    // 当前块中最小index
+    char max_index[INDEX_LEN];    // 当前块中最大index
+};
+
+// 数据文件无法识别或升级失败：报告后退出，不能把已有的文件当作空文件继续使用
+[[noreturn]] inline void storage_fatal(const string& filename, const string& reason) {
+    cerr << filename << ": " << reason << endl;
+    exit(1);
+}
+
+// 游标的终止条件：无上界、index不大于key、或index以key为前缀
+struct ScanBound {
+    enum Kind {
+        NONE,
+        UPPER,
+        PREFIX
+    };
+    Kind kind = NONE;
+    string key;
+
+    ScanBound() = default;
+    ScanBound(Kind kind, const string& key) : kind(kind), key(key) {}
+
+    bool contains(const char* index) const {
+        if (kind == UPPER) {
+            return strcmp(index, key.c_str()) <= 0;
+        }
+        if (kind == PREFIX) {
+            return strncmp(index, key.c_str(), key.size()) == 0;
+        }
+        return true;
+    }
+};
+
 template<int INDEX_LEN, typename TypeName>
-class BlockList {
+class BlockList : public PageOwner, public JournalClient {
 private:
-    fstream data_file;            // 数据文件
+    typedef KeyValue<INDEX_LEN, TypeName> Pair;
+    typedef NodeBody<INDEX_LEN, TypeName> Body;
+    typedef PlainNodeBody<INDEX_LEN, TypeName> PlainBody;
+
+    static const int BODY_BYTES = sizeof(Body::data);  // 条目区和重启点数组可用的字节数
+    static const int RESTART_BYTES = sizeof(int) + sizeof(uint64_t);  // 每个重启点的偏移和缩略键
+
+    // 键的缩略形式：前8字节按大端序组成的整数，不足8字节补0
+    // 缩略键的大小关系与strcmp一致，缩略键相等时才需要比较完整的键
+    static uint64_t abbreviate(const char* key, int length) {
+        unsigned char bytes[8] = {0};
+        memcpy(bytes, key, length < 8 ? length : 8);
+        uint64_t abbreviated = 0;
+        for (int i = 0; i < 8; i++) {
+            abbreviated = (abbreviated << 8) | bytes[i];
+        }
+        return abbreviated;
+    }
+
+    // 条目在块内下标slot处编码后的字节数（含重启点数组项），last为前一条目的键
+    static int entry_bytes(const char* last, const char* index, int length, int slot, int& shared) {
+        shared = 0;
+        int bytes = 2 + (int)sizeof(TypeName);
+        if (slot % RESTART_INTERVAL == 0) {
+            bytes += RESTART_BYTES;
+        }
+        else {
+            while (shared < length && last[shared] == index[shared]) {
+                shared++;
+            }
+        }
+        return bytes + length - shared;
+    }
+
+    // 块解码器：顺序还原条目
+    class BlockReader {
+        const Body* body = nullptr;
+        int offset = 0;            // 当前键的偏移
+        int next_offset = 0;       // 下一个键的偏移（同一重启区间内）
+        mutable TypeName current_value;    // 当前条目的值，首次访问时读取
+        mutable bool value_loaded = false;
+
+        // 只还原键，值在需要时才读
+        void load() {
+            const unsigned char* in = reinterpret_cast<const unsigned char*>(body->data + offset);
+            int shared = in[0], unshared = in[1];
+            memcpy(index + shared, in + 2, unshared);
+            length = shared + unshared;
+            index[length] = '\0';
+            next_offset = offset + 2 + unshared;
+            value_loaded = false;
+        }
+
+        // 下标为slot的条目的值在块内的偏移：值数组位于所在重启区间的键之后
+        int value_offset(int slot) const {
+            int r = slot / RESTART_INTERVAL;
+            int group_end = r + 1 < body->restart_count ? restart_offset(r + 1) : body->used;
+            int group_count = min(RESTART_INTERVAL, body->pair_count - r * RESTART_INTERVAL);
+            return group_end - (group_count - slot % RESTART_INTERVAL) * (int)sizeof(TypeName);
+        }
+
+        // 缩略键数组中第一个不小于（upper为true时大于）key的下标，无分支二分
+        int search_restart_keys(uint64_t key, bool upper) const {
+            int base = 0, count = body->restart_count;
+            while (count > 1) {
+                int half = count / 2;
+                uint64_t probe = restart_key(base + half - 1);
+                base += (upper ? probe <= key : probe < key) ? half : 0;
+                count -= half;
+            }
+            if (count == 1) {
+                uint64_t probe = restart_key(base);
+                base += (upper ? probe <= key : probe < key) ? 1 : 0;
+            }
+            return base;
+        }
+
+        // 第r个重启点条目与(key, key_value)比较；key_value为空时只比较键
+        int compare_restart(int r, const char* key, const TypeName* key_value) const {
+            const unsigned char* in = reinterpret_cast<const unsigned char*>(body->data + restart_offset(r));
+            char restart_key[INDEX_LEN];
+            memcpy(restart_key, in + 2, in[1]);
+            restart_key[in[1]] = '\0';
+            int cmp = strcmp(restart_key, key);
+            if (cmp != 0 || key_value == nullptr) return cmp;
+            TypeName restart_value;
+            memcpy(&restart_value, body->data + value_offset(r * RESTART_INTERVAL), sizeof(TypeName));
+            if (restart_value < *key_value) return -1;
+            if (restart_value > *key_value) return 1;
+            return 0;
+        }
+
+        // 跳到第一个不小于(key, key_value)的条目：先在重启点上二分，再顺序前进
+        // 二分先在缩略键上确定范围，只在缩略键相等的重启点之间比较完整的键
+        void seek(const char* key, const TypeName* key_value) {
+            int key_length = (int)strlen(key);
+            uint64_t abbreviated = abbreviate(key, key_length);
+            int left = search_restart_keys(abbreviated, false);
+            int right = search_restart_keys(abbreviated, true);
+            while (left < right) {
+                int mid = left + (right - left) / 2;
+                if (compare_restart(mid, key, key_value) < 0) {
+                    left = mid + 1;
+                }
+                else {
+                    right = mid;
+                }
+            }
+            if (body->restart_count > 0) {
+                seek_restart(left > 0 ? left - 1 : 0);
+            }
+            while (valid()) {
+                uint64_t current = abbreviate(index, length);
+                if (current > abbreviated) break;
+                if (current == abbreviated) {
+                    int cmp = strcmp(index, key);
+                    if (cmp > 0 || (cmp == 0 && (key_value == nullptr || !(value() < *key_value)))) break;
+                }
+                next();
+            }
+        }
+
+    public:
+        char index[INDEX_LEN];     // 当前条目的键
+        int length = 0;            // 当前键的长度
+        int slot = 0;              // 当前条目的下标
+
+        BlockReader() = default;
+        explicit BlockReader(const Body* body) : body(body) {
+            index[0] = '\0';
+            if (valid()) load();
+        }
+
+        bool valid() const {
+            return body != nullptr && slot < body->pair_count;
+        }
+
+        void next() {
+            slot++;
+            if (!valid()) return;
+            offset = slot % RESTART_INTERVAL == 0 ? restart_offset(slot / RESTART_INTERVAL) : next_offset;
+            load();
+        }
+
+        // 当前条目的值
+        const TypeName& value() const {
+            if (!value_loaded) {
+                memcpy(&current_value, body->data + value_offset(slot), sizeof(TypeName));
+                value_loaded = true;
+            }
+            return current_value;
+        }
+
+        // 第r个重启点的偏移
+        int restart_offset(int r) const {
+            int offset;
+            memcpy(&offset, body->data + body->used + r * sizeof(int), sizeof(int));
+            return offset;
+        }
+
+        // 第r个重启点的缩略键
+        uint64_t restart_key(int r) const {
+            uint64_t abbreviated;
+            memcpy(&abbreviated, body->data + body->used + body->restart_count * sizeof(int) + r * sizeof(uint64_t),
+                   sizeof(uint64_t));
+            return abbreviated;
+        }
+
+        // 跳到第r个重启点
+        void seek_restart(int r) {
+            slot = r * RESTART_INTERVAL;
+            offset = restart_offset(r);
+            if (valid()) load();
+        }
+
+        // 跳到第一个index不小于key的条目
+        void seek(const char* key) {
+            seek(key, nullptr);
+        }
+
+        // 跳到第一个不小于(key, key_value)的条目
+        void seek(const char* key, const TypeName& key_value) {
+            seek(key, &key_value);
+        }
+
+        // 跳到最后一个条目
+        void seek_last() {
+            if (body->restart_count == 0) return;
+            seek_restart(body->restart_count - 1);
+            while (slot + 1 < body->pair_count) {
+                next();
+            }
+        }
+    };
+
+    // 块编码器：依次追加有序条目
+    class BlockWriter {
+        Body* body = nullptr;
+        int limit = 0;             // 本块最多使用的字节数
+        int old_end = 0;           // 改写前块内已占用的字节数
+        vector<int> restarts;      // 重启点偏移
+        vector<uint64_t> restart_keys;  // 重启点缩略键
+        char group_values[RESTART_INTERVAL * sizeof(TypeName)];  // 当前重启区间尚未写出的值
+        int group_count = 0;       // 当前重启区间的条目数
+
+        // 把当前重启区间的值数组写到其键之后
+        void flush_group() {
+            memcpy(body->data + body->used, group_values, group_count * sizeof(TypeName));
+            body->used += group_count * (int)sizeof(TypeName);
+            group_count = 0;
+        }
+
+    public:
+        char first[INDEX_LEN];     // 第一个条目的键
+        char last[INDEX_LEN];      // 最后一个条目的键
+
+        BlockWriter() = default;
+
+        // 改写块：保留前keep个条目（keep须为重启点下标的倍数），其后的内容重新写入
+        BlockWriter(Body* body, int limit, int keep = 0) : body(body), limit(limit) {
+            old_end = body_bytes(*body);
+            first[0] = '\0';
+            last[0] = '\0';
+            int used = 0;
+            if (keep > 0) {
+                BlockReader reader(body);
+                memcpy(first, reader.index, reader.length + 1);
+                for (int r = 0; r * RESTART_INTERVAL < keep; r++) {
+                    restarts.push_back(reader.restart_offset(r));
+                    restart_keys.push_back(reader.restart_key(r));
+                }
+                reader.seek_restart((keep - 1) / RESTART_INTERVAL);
+                while (reader.slot < keep - 1) {
+                    reader.next();
+                }
+                memcpy(last, reader.index, reader.length + 1);
+                used = keep < body->pair_count ? reader.restart_offset(keep / RESTART_INTERVAL) : body->used;
+            }
+            body->pair_count = keep;
+            body->used = used;
+            body->restart_count = 0;
+        }
+
+        int count() const {
+            return body->pair_count;
+        }
+
+        // 追加条目，超出limit时不写入并返回false
+        bool add(const char* index, const TypeName& value) {
+            int length = (int)strnlen(index, INDEX_LEN - 1);
+            int shared;
+            int bytes = entry_bytes(last, index, length, body->pair_count, shared);
+            int pending = group_count * (int)sizeof(TypeName);
+            if (body->used + pending + bytes + (int)restarts.size() * RESTART_BYTES > limit) {
+                return false;
+            }
+
+            if (body->pair_count % RESTART_INTERVAL == 0) {
+                flush_group();
+                restarts.push_back(body->used);
+                restart_keys.push_back(abbreviate(index, length));
+            }
+            char* out = body->data + body->used;
+            out[0] = static_cast<char>(shared);
+            out[1] = static_cast<char>(length - shared);
+            memcpy(out + 2, index + shared, length - shared);
+            memcpy(group_values + group_count * sizeof(TypeName), &value, sizeof(TypeName));
+            group_count++;
+            memcpy(last, index, length);
+            last[length] = '\0';
+            if (body->pair_count == 0) {
+                memcpy(first, last, length + 1);
+            }
+            body->used += 2 + length - shared;
+            body->pair_count++;
+            return true;
+        }
+
+        // 写出最后一个重启区间的值和重启点数组，并清掉旧内容留下的尾部
+        void finish() {
+            flush_group();
+            body->restart_count = (int)restarts.size();
+            int end = body_bytes(*body);
+            if (!restarts.empty()) {
+                memcpy(body->data + body->used, restarts.data(), restarts.size() * sizeof(int));
+                memcpy(body->data + body->used + restarts.size() * sizeof(int), restart_keys.data(),
+                       restart_keys.size() * sizeof(uint64_t));
+            }
+            if (end < old_end) {
+                memset(body->data + end, 0, old_end - end);
+            }
+        }
+    };
+
+    PositionalFile data_file;     // 数据文件（STREAM模式）
+    MappedFile mapped;            // 文件映射（MMAP模式）
     string filename;              // 文件名
+    StorageMode mode = StorageMode::STREAM;    // 存储后端
+    BufferPool* pool = &BufferPool::shared();  // NodeBody缓冲池（STREAM模式）
+    Journal* journal = &Journal::shared();     // 预写日志（STREAM模式）
+
+    // STREAM模式下文件头和NodeHead的修改先留在内存，提交时记入日志，检查点时写回原位
+    map<long long, NodeHead<INDEX_LEN>> pending_heads;   // 尚未写回的NodeHead
+    set<long long> unlogged_heads;      // 自上次提交以来修改过的NodeHead
+    bool header_unlogged = false; // 文件头自上次提交以来是否被修改
 
     FileHeader file_header;       // 文件头缓存
     int header_size;          // 文件头大小
     int head_size;            // NodeHead大小
     int body_size;            // NodeBody大小
-    int head_start;           // NodeHead区域起始偏移
-    int data_start;           // 数据区域起始偏移
+
+    // 读写锁：查找和游标持共享锁，修改、日志提交和检查点持独占锁
+    // 读线程之间共享目录和NodeBody，各自的读取位置都在局部的BlockReader中
+    mutable shared_timed_mutex latch;
+
+    vector<BlockEntry<INDEX_LEN>> directory;  // 内存块目录
+    int vacuum_pos = -1;          // 整理进度（目录下标），-1表示未在整理
+    bool truncate_pending = false; // 整理完成后，检查点时截掉文件末尾不再使用的NodeBody
+    BloomFilter filters{BODY_BYTES / 2};     // 各块的布隆过滤器，按NodeBody编号，查找不存在的键时不读NodeBody
+
+    // 从文件offset处读取size字节
+    void read_at(long long offset, char* data, size_t size) {
+        if (mode == StorageMode::MMAP) {
+            memcpy(data, mapped.data() + offset, size);
+            return;
+        }
+        data_file.read(offset, data, size);
+    }
+
+    // 向文件offset处写入size字节
+    void write_at(long long offset, const char* data, size_t size) {
+        if (mode == StorageMode::MMAP) {
+            memcpy(mapped.data() + offset, data, size);
+            return;
+        }
+        data_file.write(offset, data, size);
+    }
+
+    // 文件当前大小
+    long long file_size() const {
+        if (mode == StorageMode::MMAP) {
+            return static_cast<long long>(mapped.size());
+        }
+        return data_file.size();
+    }
 
     // 读取文件头
     void read_file_header() {
-        data_file.seekg(0);
-        data_file.read(reinterpret_cast<char*>(&file_header), sizeof(FileHeader));
+        read_at(0, reinterpret_cast<char*>(&file_header), sizeof(FileHeader));
     }
 
     // 写入文件头
     void write_file_header() {
-        data_file.seekp(0);
-        data_file.write(reinterpret_cast<const char*>(&file_header), sizeof(FileHeader));
-        data_file.flush();
+        if (mode == StorageMode::STREAM) {
+            header_unlogged = true;  // 提交时记入日志
+            return;
+        }
+        write_at(0, reinterpret_cast<const char*>(&file_header), sizeof(FileHeader));
     }
 
     // 读取NodeHead
-    void read_head(NodeHead<INDEX_LEN>& head, int offset) {
+    void read_head(NodeHead<INDEX_LEN>& head, long long offset) {
         if (offset < 0) return;
-        data_file.seekg(offset);
-        data_file.read(reinterpret_cast<char*>(&head), sizeof(NodeHead<INDEX_LEN>));
+        auto it = pending_heads.find(offset);
+        if (it != pending_heads.end()) {
+            head = it->second;
+            return;
+        }
+        read_at(offset, reinterpret_cast<char*>(&head), sizeof(NodeHead<INDEX_LEN>));
     }
 
     // 写入NodeHead
-    void write_head(const NodeHead<INDEX_LEN>& head, int offset) {
+    void write_head(const NodeHead<INDEX_LEN>& head, long long offset) {
         if (offset < 0) return;
-        data_file.seekp(offset);
-        data_file.write(reinterpret_cast<const char*>(&head), sizeof(NodeHead<INDEX_LEN>));
-        data_file.flush();
+        if (mode == StorageMode::STREAM) {
+            pending_heads[offset] = head;
+            unlogged_heads.insert(offset);
+            return;
+        }
+        write_at(offset, reinterpret_cast<const char*>(&head), sizeof(NodeHead<INDEX_LEN>));
     }
 
-    // 读取NodeBody
-    void read_body(NodeBody<INDEX_LEN, TypeName>& body, int offset) {
-        if (offset < 0) return;
-        data_file.seekg(offset);
-        data_file.read(reinterpret_cast<char*>(&body), sizeof(NodeBody<INDEX_LEN, TypeName>));
+    // 把尚未写回的文件头和NodeHead写到原位
+    void write_pending() {
+        write_at(0, reinterpret_cast<const char*>(&file_header), sizeof(FileHeader));
+        for (const auto& item : pending_heads) {
+            write_at(item.first, reinterpret_cast<const char*>(&item.second), sizeof(NodeHead<INDEX_LEN>));
+        }
+        pending_heads.clear();
     }
 
-    // 写入NodeBody
-    void write_body(const NodeBody<INDEX_LEN, TypeName>& body, int offset) {
-        if (offset < 0) return;
-        data_file.seekp(offset);
-        data_file.write(reinterpret_cast<const char*>(&body), sizeof(NodeBody<INDEX_LEN, TypeName>));
-        data_file.flush();
+    // 取得并固定NodeBody（缓冲池中按编号缓存），load为false时不读盘
+    // MMAP模式下直接返回映射中的指针，在分配新块（可能重新映射）前有效
+    Body* pin_body(long long offset, bool load = true) {
+        if (mode == StorageMode::MMAP) {
+            return reinterpret_cast<Body*>(mapped.data() + offset);
+        }
+        return reinterpret_cast<Body*>(pool->pin(this, body_number(offset), body_size, load));
     }
 
-    // 在预留区域分配NodeHead
-    int allocate_head() {
-        int offset;
+    // 解除固定，dirty表示NodeBody已被修改
+    void unpin_body(long long offset, bool dirty) {
+        if (mode == StorageMode::MMAP) {
+            return;  // 修改已直接落在映射上
+        }
+        pool->unpin(this, body_number(offset), dirty);
+    }
+
+    // 在NodeHead区域分配NodeHead，区域已满时先扩展
+    long long allocate_head() {
+        long long offset;
 
         if (file_header.free_head_offset != -1) {
             // 从空闲链表分配
@@ -117,9 +580,11 @@ private:
             file_header.free_head_offset = free_head.next_offset;
         }
         else {
-            // 从预留区域分配
-            offset = head_start + file_header.count * head_size;
-            file_header.count++;
+            if (file_header.head_count == file_header.head_capacity) {
+                grow_heads();
+            }
+            offset = file_header.head_start + (long long)file_header.head_count * head_size;
+            file_header.head_count++;
         }
 
         write_file_header();  // 写回文件头
@@ -127,26 +592,29 @@ private:
     }
 
     // 分配NodeBody
-    int allocate_body() {
-        int offset;
+    long long allocate_body() {
+        long long offset;
 
-        if (file_header.free_body_offset != -1) {
+        if (file_header.free_body != -1) {
             // 从空闲链表分配
-            offset = file_header.free_body_offset;
-            NodeBody<INDEX_LEN, TypeName> free_body;
-            read_body(free_body, offset);
-            file_header.free_body_offset = free_body.next_free;
+            offset = body_at(file_header.free_body);
+            Body* free_body = pin_body(offset);
+            file_header.free_body = free_body->next_free;
+            unpin_body(offset, false);
         }
         else {
-            // 从数据区域分配
-            offset = data_start + file_header.count * body_size;
+            // 从数据区域末尾分配
+            offset = body_at(file_header.body_count++);
+            if (mode == StorageMode::MMAP) {
+                mapped.reserve(offset + body_size);  // 扩展文件和映射
+            }
         }
         write_file_header();  // 写回文件头
         return offset;
     }
 
     // 释放NodeHead到空闲链表
-    void free_head(int offset) {
+    void free_head(long long offset) {
         NodeHead<INDEX_LEN> freed_head;
         memset(&freed_head, 0, sizeof(NodeHead<INDEX_LEN>));
         freed_head.next_offset = file_header.free_head_offset;
@@ -156,607 +624,1136 @@ private:
     }
 
     // 释放NodeBody到空闲链表
-    void free_body(int offset) {
-        NodeBody<INDEX_LEN, TypeName> freed_body;
-        memset(&freed_body, 0, sizeof(NodeBody<INDEX_LEN, TypeName>));
-        freed_body.next_free = file_header.free_body_offset;
-        file_header.free_body_offset = offset;
-        write_body(freed_body, offset);
+    void free_body(long long offset) {
+        Body* freed_body = pin_body(offset, false);
+        memset(freed_body, 0, body_size);
+        freed_body->next_free = file_header.free_body;
+        file_header.free_body = body_number(offset);
+        unpin_body(offset, true);
+        filters.clear(body_number(offset));
         write_file_header();  // 写回文件头
     }
 
-    // 查找合适的插入块
-    int find_suitable_block(const char* index) {
-    if (file_header.first_head_offset == -1) {
-        return -1;
+    // NodeHead区域在数据区中占用的NodeBody编号范围[first, first + count)，区域在数据区之前时count为0
+    int head_run_first() const {
+        return static_cast<int>((file_header.head_start - file_header.data_start) / body_size);
     }
 
-    int current_offset = file_header.first_head_offset;
-    int prev_offset = -1;
-
-    while (current_offset != -1) {
-        NodeHead<INDEX_LEN> current_head;
-        read_head(current_head, current_offset);
-
-        int cmp_max = strcmp(index, current_head.max_index);
-
-        if (cmp_max < 0) {
-            // index < 当前块max_index
-            return current_offset;
+    int head_run_count() const {
+        if (file_header.head_start < file_header.data_start) {
+            return 0;
         }
-        else if (cmp_max == 0) {
-            // index == 当前块max_index
-            // 先检查当前块是否已满
-            if (current_head.pair_count < BLOCK_SIZE) {
-                return current_offset;
-            }
+        return static_cast<int>(((long long)file_header.head_capacity * head_size + body_size - 1) / body_size);
+    }
 
-            // 当前块已满，检查下一个块
-            if (current_head.next_offset == -1) {
-                return current_offset;  // 没有下一个块
-            }
+    // 按目录顺序把所有块的NodeHead重新写到NodeHead区域开头，清空空闲NodeHead链表
+    void lay_out_heads() {
+        for (int pos = 0; pos < (int)directory.size(); pos++) {
+            directory[pos].head_offset = sequential_head(pos);
+        }
+        for (int pos = 0; pos < (int)directory.size(); pos++) {
+            write_head_at(pos);
+        }
+        file_header.head_count = (int)directory.size();
+        file_header.free_head_offset = -1;
+        update_list_ends();
+        write_file_header();
+    }
 
-            NodeHead<INDEX_LEN> next_head;
-            read_head(next_head, current_head.next_offset);
-            int cmp_next_min = strcmp(index, next_head.min_index);
+    // 把NodeHead区域改到从start开始、容量为capacity个NodeHead的位置，现有的NodeHead按目录顺序写过去
+    // 旧区域作废，尚未写回的NodeHead直接丢弃；旧区域在数据区中时，其位置留给整理回收
+    // 新区域在数据区中时，缓冲池里这些位置上过时的NodeBody也要丢弃，以免写回时覆盖NodeHead
+    void relocate_heads(long long start, int capacity) {
+        long long old_start = file_header.head_start;
+        long long old_end = old_start + (long long)file_header.head_capacity * head_size;
+        for (auto it = pending_heads.lower_bound(old_start); it != pending_heads.end() && it->first < old_end;) {
+            unlogged_heads.erase(it->first);
+            it = pending_heads.erase(it);
+        }
 
-            if (cmp_next_min == 0) {
-                // index也等于下一个块的min_index
-                if (next_head.pair_count < BLOCK_SIZE) {
-                    return current_head.next_offset;
-                } else {
-                    return current_offset;  // 两个块都满
-                }
-            }
-            else if (cmp_next_min < 0) {
-                // index < 下一个块的min_index
-                return current_offset;
+        file_header.head_start = start;
+        file_header.head_capacity = capacity;
+        int first = head_run_first(), count = head_run_count();
+        if (count > 0) {
+            file_header.body_count = max(file_header.body_count, first + count);
+            if (mode == StorageMode::MMAP) {
+                mapped.reserve(body_at(first + count));
             }
             else {
-                // index > 下一个块的min_index，不应该发生
-                // 因为当前块max_index不可能大于下一个块min_index
-                prev_offset = current_offset;
-                current_offset = current_head.next_offset;
+                for (int number = first; number < first + count; number++) {
+                    pool->discard(this, number);
+                }
             }
         }
+        lay_out_heads();
+    }
+
+    // NodeHead区域已满：在数据区末尾分配一段连续的NodeBody位置作为新区域，容量至少翻倍
+    void grow_heads() {
+        long long need = max(2LL * file_header.head_capacity, (long long)directory.size() + 1) * head_size;
+        int count = static_cast<int>((need + body_size - 1) / body_size);
+        relocate_heads(body_at(file_header.body_count), static_cast<int>((long long)count * body_size / head_size));
+    }
+
+    // 由目录项生成NodeHead并写回文件（前后指针取自目录中的相邻块）
+    void write_head_at(int pos) {
+        const BlockEntry<INDEX_LEN>& entry = directory[pos];
+        NodeHead<INDEX_LEN> head;
+        memset(&head, 0, sizeof(NodeHead<INDEX_LEN>));
+        head.prev_offset = pos > 0 ? directory[pos - 1].head_offset : -1;
+        head.next_offset = pos + 1 < (int)directory.size() ? directory[pos + 1].head_offset : -1;
+        head.body_offset = entry.body_offset;
+        head.pair_count = entry.pair_count;
+        memcpy(head.min_index, entry.min_index, INDEX_LEN);
+        memcpy(head.max_index, entry.max_index, INDEX_LEN);
+        write_head(head, entry.head_offset);
+    }
+
+    // 根据目录更新文件头中的首尾块
+    void update_list_ends() {
+        if (directory.empty()) {
+            file_header.first_head_offset = -1;
+            file_header.last_head_offset = -1;
+        }
         else {
-            // index > 当前块max_index
-            prev_offset = current_offset;
-            current_offset = current_head.next_offset;
+            file_header.first_head_offset = directory.front().head_offset;
+            file_header.last_head_offset = directory.back().head_offset;
         }
     }
 
-    // 遍历完所有块，index大于所有块的max_index
-    return prev_offset;  // 插入到最后一个块
-}
+    // 打开文件时一次性读入NodeHead区域，沿链表顺序建立内存目录
+    void load_directory() {
+        directory.clear();
+        if (file_header.first_head_offset == -1 || file_header.head_count <= 0) {
+            return;
+        }
 
-    // 创建新块
-    int create_new_block(int insert_after) {
-        // 分配NodeHead
-        int new_head_offset = allocate_head();
+        vector<char> heads(static_cast<size_t>(file_header.head_count) * head_size);
+        read_at(file_header.head_start, heads.data(), heads.size());
 
-        // 分配NodeBody
-        int new_body_offset = allocate_body();
+        long long current_offset = file_header.first_head_offset;
+        while (current_offset != -1 && (int)directory.size() < file_header.head_count) {
+            long long relative = current_offset - file_header.head_start;
+            if (relative < 0 || relative % head_size != 0 || relative / head_size >= file_header.head_count) {
+                storage_fatal(filename, "corrupt block list");
+            }
+            NodeHead<INDEX_LEN> head;
+            memcpy(&head, heads.data() + relative, sizeof(NodeHead<INDEX_LEN>));
+
+            BlockEntry<INDEX_LEN> entry;
+            entry.head_offset = current_offset;
+            entry.body_offset = head.body_offset;
+            entry.pair_count = head.pair_count;
+            memcpy(entry.min_index, head.min_index, INDEX_LEN);
+            memcpy(entry.max_index, head.max_index, INDEX_LEN);
+            directory.push_back(entry);
+
+            current_offset = head.next_offset;
+        }
+    }
 
-        // 创建新的NodeHead
-        NodeHead<INDEX_LEN> new_head;
-        memset(&new_head, 0, sizeof(NodeHead<INDEX_LEN>));
-        new_head.body_offset = new_body_offset;
-        new_head.pair_count = 0;
-        new_head.min_index[0] = '\0';
-        new_head.max_index[0] = '\0';
+    // NodeBody的编号，用作缓冲池的页号和布隆过滤器的块号
+    int body_number(long long body_offset) const {
+        return static_cast<int>((body_offset - file_header.data_start) / body_size);
+    }
 
-        if (insert_after == -1) {
-            // 插入到链表头部
-            if (file_header.first_head_offset != -1) {
-                NodeHead<INDEX_LEN> prev_head;
-                read_head(prev_head, file_header.first_head_offset);
-                prev_head.prev_offset = new_head_offset;
-                write_head(prev_head, file_header.first_head_offset);
-            }
-            new_head.prev_offset = -1;
-            new_head.next_offset = file_header.first_head_offset;
-            file_header.first_head_offset = new_head_offset;
+    // 编号为number的NodeBody的偏移
+    long long body_at(int number) const {
+        return file_header.data_start + (long long)number * body_size;
+    }
 
-            if (new_head.next_offset == -1) {
-                file_header.last_head_offset = new_head_offset;
+    // 布隆过滤器旁路文件的核对值：由目录内容计算
+    uint64_t directory_stamp() const {
+        uint64_t stamp = 14695981039346656037ull;
+        auto mix = [&stamp](const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                stamp ^= bytes[i];
+                stamp *= 1099511628211ull;
             }
+        };
+        mix(&file_header.data_start, sizeof(long long));  // 编号的基准
+        for (const auto& entry : directory) {
+            mix(&entry.head_offset, sizeof(long long));
+            mix(&entry.body_offset, sizeof(long long));
+            mix(&entry.pair_count, sizeof(int));
+            mix(entry.min_index, strlen(entry.min_index) + 1);
+            mix(entry.max_index, strlen(entry.max_index) + 1);
         }
-        else {
-            // 插入到insert_after之后
-            NodeHead<INDEX_LEN> after_head;
-            read_head(after_head, insert_after);
-
-            new_head.prev_offset = insert_after;
-            new_head.next_offset = after_head.next_offset;
-            after_head.next_offset = new_head_offset;
+        return stamp;
+    }
 
-            write_head(after_head, insert_after);
+    // 读入布隆过滤器，旁路文件缺失或过期时扫描全部块重建
+    void load_filters() {
+        if (filters.load(filename + ".bloom", directory_stamp())) {
+            return;
+        }
+        for (const auto& entry : directory) {
+            int number = body_number(entry.body_offset);
+            filters.clear(number);
+            for (BlockReader reader(pin_body(entry.body_offset)); reader.valid(); reader.next()) {
+                filters.add(number, reader.index);
+            }
+            unpin_body(entry.body_offset, false);
+        }
+    }
 
-            if (new_head.next_offset != -1) {
-                NodeHead<INDEX_LEN> next_head;
-                read_head(next_head, new_head.next_offset);
-                next_head.prev_offset = new_head_offset;
-                write_head(next_head, new_head.next_offset);
+    // 二分查找第一个max_index >= index的块，不存在时返回块数
+    int lower_block(const char* index) const {
+        int left = 0, right = (int)directory.size();
+        while (left < right) {
+            int mid = left + (right - left) / 2;
+            if (strcmp(directory[mid].max_index, index) < 0) {
+                left = mid + 1;
             }
             else {
-                // 更新尾部
-                file_header.last_head_offset = new_head_offset;
+                right = mid;
             }
         }
+        return left;
+    }
+
+    // 查找(index, value)应插入的块，返回目录下标；目录为空时返回-1
+    int find_suitable_block(const char* index, const TypeName& value) {
+        if (directory.empty()) {
+            return -1;
+        }
 
-        // 初始化NodeBody
-        NodeBody<INDEX_LEN, TypeName> new_body;
-        memset(&new_body, 0, sizeof(NodeBody<INDEX_LEN, TypeName>));
-        new_body.next_free = -1;
+        int pos = lower_block(index);
+        if (pos == (int)directory.size()) {
+            return pos - 1;  // index大于所有块的max_index，插入到最后一个块
+        }
+
+        // 相同index跨越多个块时，按value找到第一个末项不小于(index, value)的块
+        while (pos + 1 < (int)directory.size()
+               && strcmp(directory[pos].max_index, index) == 0
+               && strcmp(directory[pos + 1].min_index, index) == 0) {
+            long long body_offset = directory[pos].body_offset;
+            BlockReader reader(pin_body(body_offset));
+            reader.seek_last();
+            bool fits = !(reader.value() < value);
+            unpin_body(body_offset, false);
+            if (fits) {
+                break;
+            }
+            pos++;
+        }
+        return pos;
+    }
 
-        // 写入新块
-        write_head(new_head, new_head_offset);
-        write_body(new_body, new_body_offset);
+    // 在目录下标pos处创建新块
+    int create_new_block(int pos) {
+        BlockEntry<INDEX_LEN> entry;
+        memset(&entry, 0, sizeof(BlockEntry<INDEX_LEN>));
+        entry.head_offset = allocate_head();
+        entry.body_offset = allocate_body();
+        entry.pair_count = 0;
+        directory.insert(directory.begin() + pos, entry);
+        filters.clear(body_number(entry.body_offset));
+
+        // 初始化NodeBody（可能是缓冲池中仍留有旧内容的空闲块）
+        Body* new_body = pin_body(entry.body_offset, false);
+        memset(new_body, 0, body_size);
+        new_body->next_free = -1;
+        unpin_body(entry.body_offset, true);
+
+        // 写入新块及相邻块的NodeHead
+        write_heads_around(pos);
+        update_list_ends();
         write_file_header();
 
-        return new_head_offset;
+        return pos;
     }
 
-     // 在块中插入条目
-    bool insert_to_block(int head_offset, const char* index, TypeName value) {
-        NodeHead<INDEX_LEN> head;
-        read_head(head, head_offset);
+    // 写回pos处块及其前后块的NodeHead
+    void write_heads_around(int pos) {
+        for (int i = max(pos - 1, 0); i <= pos + 1 && i < (int)directory.size(); i++) {
+            write_head_at(i);
+        }
+    }
 
-        // 安全检查
-        if (head.pair_count >= BLOCK_SIZE) {
-            return false;  // 块已满，需要分裂
+    // 解码块中下标不小于first的条目（first须为重启点下标的倍数）
+    static void decode(const Body& body, int first, vector<Pair>& pairs) {
+        pairs.clear();
+        pairs.reserve(body.pair_count - first + 1);
+        BlockReader reader(&body);
+        if (first > 0) {
+            reader.seek_restart(first / RESTART_INTERVAL);
+        }
+        for (; reader.valid(); reader.next()) {
+            Pair pair;
+            memcpy(pair.index, reader.index, reader.length + 1);
+            pair.value = reader.value();
+            pairs.push_back(pair);
         }
+    }
 
-        NodeBody<INDEX_LEN, TypeName> body;
-        read_body(body, head.body_offset);
+    // pairs编码成一个块所需的字节数
+    static int encoded_size(const vector<Pair>& pairs) {
+        int bytes = 0, shared;
+        const char* last = "";
+        for (size_t i = 0; i < pairs.size(); i++) {
+            bytes += entry_bytes(last, pairs[i].index, (int)strlen(pairs[i].index), (int)i, shared);
+            last = pairs[i].index;
+        }
+        return bytes;
+    }
 
-        // 二分查找插入位置
-        int left = 0, right = head.pair_count - 1;
-        int insert_pos = head.pair_count;
+    // 块内已占用的字节数
+    static int body_bytes(const Body& body) {
+        return body.used + body.restart_count * RESTART_BYTES;
+    }
 
-        while (left <= right) {
-            int mid = left + (right - left) / 2;
-            int cmp = strcmp(body.pairs[mid].index, index);
-            if (cmp < 0) {
-                left = mid + 1;
+    // 把有序条目依次写入pos处的块（保留块内前keep个条目）：第一块最多写first_limit字节，
+    // 写不下的部分放入其后新建的块
+    // refilter为true时（分裂、合并后块中的键换了一批）重建第一块的布隆过滤器；原地插入或删除时不重建：
+    // 新插入的键由调用方加入，删除留下的位只会让查找多读一次块；新建的块总是重建
+    void write_blocks(int pos, const vector<Pair>& pairs, int first_limit, int keep = 0, bool refilter = true) {
+        size_t next = 0;
+        int limit = first_limit;
+        while (true) {
+            BlockEntry<INDEX_LEN>& entry = directory[pos];
+            long long body_offset = entry.body_offset;
+            int number = body_number(body_offset);
+            if (refilter) {
+                filters.clear(number);
             }
-            else if (cmp > 0) {
-                right = mid - 1;
-                insert_pos = mid;
-            }
-            else {
-                // 索引相同，比较值
-                if (body.pairs[mid].value < value) {
-                    left = mid + 1;
-                }
-                else if (body.pairs[mid].value > value) {
-                    right = mid - 1;
-                    insert_pos = mid;
-                }
-                else {
-                    return true;  // 已存在，不插入
+            BlockWriter writer(pin_body(body_offset), limit, keep);
+            keep = 0;
+            while (next < pairs.size() && writer.add(pairs[next].index, pairs[next].value)) {
+                if (refilter) {
+                    filters.add(number, pairs[next].index);
                 }
+                next++;
             }
-        }
+            writer.finish();
+            finish_block(pos, writer);
+            unpin_body(body_offset, true);
 
-        // 移动元素
-        for (int i = head.pair_count; i > insert_pos; i--) {
-            body.pairs[i] = body.pairs[i - 1];
+            if (next == pairs.size()) {
+                return;
+            }
+            pos = create_new_block(pos + 1);
+            limit = BODY_BYTES;
+            refilter = true;
         }
+    }
 
-        // 插入新元素
-        strncpy(body.pairs[insert_pos].index, index, INDEX_LEN - 1);
-        body.pairs[insert_pos].index[INDEX_LEN - 1] = '\0';
-        body.pairs[insert_pos].value = value;
+    // 按编码器的结果更新目录项并写回NodeHead
+    void finish_block(int pos, const BlockWriter& writer) {
+        BlockEntry<INDEX_LEN>& entry = directory[pos];
+        entry.pair_count = writer.count();
+        strcpy(entry.min_index, writer.first);
+        strcpy(entry.max_index, writer.last);
+        write_head_at(pos);
+    }
 
-        head.pair_count++;
+    // 在块中查找第一个不小于(index, value)的条目，返回其下标；found表示是否恰好相等
+    // keep为该条目所在重启区间的起点，其前的条目改写时可原样保留
+    int search_in_block(int pos, const char* index, const TypeName& value, bool& found, int& keep) {
+        long long body_offset = directory[pos].body_offset;
+        BlockReader reader(pin_body(body_offset));
+        reader.seek(index, value);
+        found = reader.valid() && strcmp(reader.index, index) == 0 && !(reader.value() > value);
+        unpin_body(body_offset, false);
+        keep = reader.slot / RESTART_INTERVAL * RESTART_INTERVAL;
+        return reader.slot;
+    }
 
-        // 更新索引范围
-        if (head.pair_count == 1) {
-            strncpy(head.min_index, index, INDEX_LEN - 1);
-            strncpy(head.max_index, index, INDEX_LEN - 1);
-            head.min_index[INDEX_LEN - 1] = '\0';
-            head.max_index[INDEX_LEN - 1] = '\0';
+    // 在块中插入条目：只重新编码插入位置所在重启区间之后的部分，放不下时整块按字节数对半分裂
+    void insert_to_block(int pos, const char* index, TypeName value) {
+        bool found;
+        int keep;
+        int slot = search_in_block(pos, index, value, found, keep);
+        if (found) {
+            return;  // 已存在，不插入
         }
-        else {
-            if (strcmp(index, head.min_index) < 0) {
-                strncpy(head.min_index, index, INDEX_LEN - 1);
-                head.min_index[INDEX_LEN - 1] = '\0';
-            }
-            if (strcmp(index, head.max_index) > 0) {
-                strncpy(head.max_index, index, INDEX_LEN - 1);
-                head.max_index[INDEX_LEN - 1] = '\0';
-            }
+
+        Pair pair;
+        memset(&pair, 0, sizeof(Pair));
+        strncpy(pair.index, index, INDEX_LEN - 1);
+        pair.value = value;
+
+        long long body_offset = directory[pos].body_offset;
+        const Body* body = pin_body(body_offset);
+        vector<Pair> pairs;
+        decode(*body, keep, pairs);
+        pairs.insert(pairs.begin() + (slot - keep), pair);
+        // 重启点处的条目不共享前缀，保留部分的大小不受后续条目影响
+        int kept_bytes = 0;
+        if (keep > 0) {
+            BlockReader reader(body);
+            kept_bytes = keep < body->pair_count ? reader.restart_offset(keep / RESTART_INTERVAL) : body->used;
+            kept_bytes += keep / RESTART_INTERVAL * RESTART_BYTES;
         }
+        unpin_body(body_offset, false);
 
-        // 写回
-        write_head(head, head_offset);
-        write_body(body, head.body_offset);
+        if (kept_bytes + encoded_size(pairs) <= BODY_BYTES) {
+            write_blocks(pos, pairs, BODY_BYTES, keep, false);
+            filters.add(body_number(body_offset), pair.index);
+            return;
+        }
 
-        return true;
+        decode(*pin_body(body_offset), 0, pairs);
+        unpin_body(body_offset, false);
+        pairs.insert(pairs.begin() + slot, pair);
+        write_blocks(pos, pairs, encoded_size(pairs) / 2);
     }
 
-    // 查找包含特定index的第一个块
-    int find_first_block_by_index(const char* index) {
-        int current_offset = file_header.first_head_offset;
+    // 将pos+1处的块合并进pos处的块，合并后放不下时返回false
+    bool merge_blocks(int pos) {
+        vector<Pair> pairs, right_pairs;
+        BlockEntry<INDEX_LEN> right_entry = directory[pos + 1];
+        decode(*pin_body(directory[pos].body_offset), 0, pairs);
+        unpin_body(directory[pos].body_offset, false);
+        decode(*pin_body(right_entry.body_offset), 0, right_pairs);
+        unpin_body(right_entry.body_offset, false);
+
+        pairs.insert(pairs.end(), right_pairs.begin(), right_pairs.end());
+        if (encoded_size(pairs) > BODY_BYTES) {
+            return false;
+        }
+        write_blocks(pos, pairs, BODY_BYTES);
 
-        while (current_offset != -1) {
-            NodeHead<INDEX_LEN> current_head;
-            read_head(current_head, current_offset);
+        // 从目录中移除右块，写入左块及其新的后继
+        directory.erase(directory.begin() + pos + 1);
+        write_head_at(pos);
+        if (pos + 1 < (int)directory.size()) {
+            write_head_at(pos + 1);
+        }
+        update_list_ends();
 
-            if (strcmp(index, current_head.max_index) <= 0) {
-                if (strcmp(index, current_head.min_index) >= 0 || current_head.prev_offset == -1) {
-                    return current_offset;
-                }
-            }
+        // 释放右块的head和body
+        free_head(right_entry.head_offset);
+        free_body(right_entry.body_offset);
+        return true;
+    }
 
-            if (current_head.next_offset == -1 || strcmp(index, current_head.min_index) < 0) {
-                break;
-            }
+    // 尝试合并块
+    void try_merge_blocks(int pos) {
+        const Body* body = pin_body(directory[pos].body_offset);
+        int bytes = body_bytes(*body);
+        unpin_body(directory[pos].body_offset, false);
 
-            current_offset = current_head.next_offset;
+        if (bytes >= BODY_BYTES / BLOCK_SIZE * MIN_BLOCK_SIZE) {
+            return;  // 不需要合并
         }
 
-        return -1;
+        // 尝试与前面的块合并，再尝试与后面的块合并
+        if (pos > 0 && merge_blocks(pos - 1)) {
+            return;
+        }
+        if (pos + 1 < (int)directory.size()) {
+            merge_blocks(pos);
+        }
     }
 
-     // 分裂块
-    void split_block(int head_offset) {
-        NodeHead<INDEX_LEN> old_head;
-        read_head(old_head, head_offset);
+    // 在块中删除条目
+    bool delete_from_block(int pos, const char* index, TypeName value) {
+        bool found;
+        int keep;
+        int slot = search_in_block(pos, index, value, found, keep);
+        if (!found) {
+            return false;  // 未找到
+        }
 
-        NodeBody<INDEX_LEN, TypeName> old_body;
-        read_body(old_body, old_head.body_offset);
+        long long body_offset = directory[pos].body_offset;
+        vector<Pair> pairs;
+        decode(*pin_body(body_offset), keep, pairs);
+        unpin_body(body_offset, false);
 
-        // 创建新块
-        int new_head_offset = create_new_block(head_offset);
-        if (new_head_offset == -1) return;
+        // 删除后重新编码其后的条目（前缀共享可能变化，极端情况下会放不下而分出新块）
+        pairs.erase(pairs.begin() + (slot - keep));
+        write_blocks(pos, pairs, BODY_BYTES, keep, false);
+        return true;
+    }
 
-        NodeHead<INDEX_LEN> new_head;
-        read_head(new_head, new_head_offset);
-        NodeBody<INDEX_LEN, TypeName> new_body;
-        read_body(new_body, new_head.body_offset);
+    // 整理后pos处的块应在的位置：NodeHead和NodeBody都按目录顺序排列，NodeBody跳过NodeHead区域占用的编号
+    long long sequential_head(int pos) const {
+        return file_header.head_start + (long long)pos * head_size;
+    }
 
-        // 计算分裂点（大致一半）
-        int split_point = old_head.pair_count / 2;
+    long long sequential_body(int pos) const {
+        int number = pos;
+        if (head_run_count() > 0 && number >= head_run_first()) {
+            number += head_run_count();
+        }
+        return body_at(number);
+    }
 
-        // 将后半部分数据移动到新块
-        new_head.pair_count = old_head.pair_count - split_point;
-        for (int i = 0; i < new_head.pair_count; i++) {
-            new_body.pairs[i] = old_body.pairs[split_point + i];
+    // 是否值得整理：空闲块或在文件中不紧接前一块的块过多
+    bool fragmented() const {
+        int blocks = (int)directory.size();
+        int scattered = 0;
+        for (int i = 1; i < blocks; i++) {
+            if (directory[i].body_offset != directory[i - 1].body_offset + body_size) {
+                scattered++;
+            }
+        }
+        int spare = file_header.body_count - head_run_count() - blocks;
+        return max(spare, scattered) * 4 > blocks + VACUUM_SLACK;
+    }
 
-            // 更新新块的索引范围
-            if (i == 0) {
-                strncpy(new_head.min_index, new_body.pairs[i].index, INDEX_LEN - 1);
-                strncpy(new_head.max_index, new_body.pairs[i].index, INDEX_LEN - 1);
+    // 整理时把不足半满的块补到3/4满：与后继块合起来放得下时合并，否则从后继块开头取条目
+    // 不写满是为了给之后的插入留出空间，以免刚整理过的块马上分裂
+    void pack_block(int pos) {
+        int limit = BODY_BYTES / 4 * 3;
+        while (pos + 1 < (int)directory.size()) {
+            long long body_offset = directory[pos].body_offset;
+            long long right_offset = directory[pos + 1].body_offset;
+            const Body* body = pin_body(body_offset);
+            int bytes = body_bytes(*body);
+            vector<Pair> pairs, right_pairs;
+            if (bytes < BODY_BYTES / 2) {
+                decode(*body, 0, pairs);
             }
-            else {
-                if (strcmp(new_body.pairs[i].index, new_head.min_index) < 0) {
-                    strncpy(new_head.min_index, new_body.pairs[i].index, INDEX_LEN - 1);
-                }
-                if (strcmp(new_body.pairs[i].index, new_head.max_index) > 0) {
-                    strncpy(new_head.max_index, new_body.pairs[i].index, INDEX_LEN - 1);
-                }
+            unpin_body(body_offset, false);
+            if (bytes >= BODY_BYTES / 2) {
+                return;
+            }
+            decode(*pin_body(right_offset), 0, right_pairs);
+            unpin_body(right_offset, false);
+            pairs.insert(pairs.end(), right_pairs.begin(), right_pairs.end());
+            if (encoded_size(pairs) <= limit) {
+                merge_blocks(pos);
+                continue;
             }
+
+            // 左块写到limit为止，余下的条目写回右块
+            int number = body_number(body_offset);
+            filters.clear(number);
+            BlockWriter writer(pin_body(body_offset), limit);
+            size_t next = 0;
+            while (writer.add(pairs[next].index, pairs[next].value)) {
+                filters.add(number, pairs[next].index);
+                next++;
+            }
+            writer.finish();
+            finish_block(pos, writer);
+            unpin_body(body_offset, true);
+            write_blocks(pos + 1, vector<Pair>(pairs.begin() + next, pairs.end()), BODY_BYTES);
+            return;
         }
-        new_head.min_index[INDEX_LEN - 1] = '\0';
-        new_head.max_index[INDEX_LEN - 1] = '\0';
+    }
 
-        // 更新旧块的条目数和索引范围
-        old_head.pair_count = split_point;
-        if (old_head.pair_count > 0) {
-            strncpy(old_head.min_index, old_body.pairs[0].index, INDEX_LEN - 1);
-            strncpy(old_head.max_index, old_body.pairs[old_head.pair_count - 1].index, INDEX_LEN - 1);
-            old_head.min_index[INDEX_LEN - 1] = '\0';
-            old_head.max_index[INDEX_LEN - 1] = '\0';
+    // 占用给定NodeHead / NodeBody位置的块的目录下标，没有时返回-1
+    int head_owner(long long head_offset) const {
+        for (int i = 0; i < (int)directory.size(); i++) {
+            if (directory[i].head_offset == head_offset) return i;
         }
+        return -1;
+    }
 
-        // 更新链表连接
-        old_head.next_offset = new_head_offset;
+    int body_owner(long long body_offset) const {
+        for (int i = 0; i < (int)directory.size(); i++) {
+            if (directory[i].body_offset == body_offset) return i;
+        }
+        return -1;
+    }
 
-        if (new_head.next_offset != -1) {
-            NodeHead<INDEX_LEN> next_head;
-            read_head(next_head, new_head.next_offset);
-            next_head.prev_offset = new_head_offset;
+    // 把pos处块的NodeBody和NodeHead移到按目录顺序排列的位置，目标位置被其他块占用时两者交换
+    // 调用前空闲链表须已清空，未被占用的位置都可直接使用
+    void place_block(int pos) {
+        long long source = directory[pos].body_offset;
+        long long target = sequential_body(pos);
+        if (source != target) {
+            int other = body_owner(target);
+            Body* from = pin_body(source);
+            Body* to = pin_body(target, other != -1);
+            if (other == -1) {
+                memcpy(to, from, body_size);
+                filters.move(body_number(source), body_number(target));
+            }
+            else {
+                vector<char> buffer(body_size);
+                memcpy(buffer.data(), to, body_size);
+                memcpy(to, from, body_size);
+                memcpy(from, buffer.data(), body_size);
+                filters.swap(body_number(source), body_number(target));
+                directory[other].body_offset = source;
+                write_head_at(other);
+            }
+            unpin_body(target, true);
+            unpin_body(source, other != -1);
+            directory[pos].body_offset = target;
+            write_head_at(pos);
         }
-        else {
-            file_header.last_head_offset = new_head_offset;
+
+        long long head_target = sequential_head(pos);
+        if (directory[pos].head_offset != head_target) {
+            int other = head_owner(head_target);
+            if (other != -1) {
+                directory[other].head_offset = directory[pos].head_offset;
+                write_heads_around(other);
+            }
+            directory[pos].head_offset = head_target;
+            write_heads_around(pos);
+            update_list_ends();
         }
+    }
 
-        // 清空旧块中已移动的数据
-        for (int i = split_point; i < BLOCK_SIZE; i++) {
-            memset(&old_body.pairs[i], 0, sizeof(KeyValue<INDEX_LEN, TypeName>));
+    // 整理完成后截掉文件末尾不再使用的NodeBody
+    void truncate_tail() {
+        if (truncate_pending) {
+            data_file.truncate(body_at(file_header.body_count));
+            truncate_pending = false;
         }
+    }
 
-        // 写入所有更新
-        write_head(old_head, head_offset);
-        write_body(old_body, old_head.body_offset);
+    // (index, value)的比较，用于批量装载前的排序
+    static bool pair_less(const pair<string, TypeName>& a, const pair<string, TypeName>& b) {
+        int cmp = strcmp(a.first.c_str(), b.first.c_str());
+        return cmp < 0 || (cmp == 0 && a.second < b.second);
+    }
 
-        write_head(new_head, new_head_offset);
-        write_body(new_body, new_head.body_offset);
+    // 把已排序的条目依次编码进新块，每块写满limit字节后另起一块
+    template<typename Iterator>
+    void load_sorted(Iterator begin, Iterator end, int limit) {
+        int pos = -1;
+        BlockWriter writer;
+        Iterator prev = end;
+        char index[INDEX_LEN];
+        for (Iterator it = begin; it != end; prev = it, ++it) {
+            if (prev != end && !pair_less(*prev, *it)) {
+                continue;  // 重复条目只保留一个
+            }
+            strncpy(index, it->first.c_str(), INDEX_LEN - 1);
+            index[INDEX_LEN - 1] = '\0';
+            if (pos != -1 && writer.add(index, it->second)) {
+                filters.add(body_number(directory[pos].body_offset), index);
+                continue;
+            }
+            if (pos != -1) {
+                writer.finish();
+                finish_block(pos, writer);
+                unpin_body(directory[pos].body_offset, true);
+            }
+            pos = create_new_block((int)directory.size());
+            writer = BlockWriter(pin_body(directory[pos].body_offset), limit);
+            writer.add(index, it->second);
+            filters.add(body_number(directory[pos].body_offset), index);
+        }
+        if (pos != -1) {
+            writer.finish();
+            finish_block(pos, writer);
+            unpin_body(directory[pos].body_offset, true);
+        }
         write_file_header();
     }
 
-    // 合并两个块
-    void merge_blocks(NodeHead<INDEX_LEN>& left_head, NodeHead<INDEX_LEN>& right_head, int left_offset, int right_offset) {
-        NodeBody<INDEX_LEN, TypeName> left_body, right_body;
-        read_body(left_body, left_head.body_offset);
-        read_body(right_body, right_head.body_offset);
+    // 插入一个条目（调用方持有独占锁）
+    void insert_entry(const char* index, const TypeName& value) {
+        // 查找合适的块
+        int target = find_suitable_block(index, value);
 
-        // 将右块数据复制到左块
-        for (int i = 0; i < right_head.pair_count; i++) {
-            left_body.pairs[left_head.pair_count + i] = right_body.pairs[i];
+        // 处理数据库为空的情况
+        if (target == -1) {
+            target = create_new_block(0);
         }
-        left_head.pair_count += right_head.pair_count;
-        left_head.next_offset = right_head.next_offset;
 
-        // 更新左块的max_index
-        if (right_head.pair_count > 0) {
-            strncpy(left_head.max_index, right_body.pairs[right_head.pair_count - 1].index, INDEX_LEN - 1);
-            left_head.max_index[INDEX_LEN - 1] = '\0';
+        // 块放不下时在插入过程中分裂
+        insert_to_block(target, index, value);
+        write_file_header();
+    }
+
+    // 文件头的公共部分：标识、版本、空链表
+    void reset_file_header() {
+        memset(&file_header, 0, sizeof(FileHeader));
+        file_header.magic = BLOCKLIST_MAGIC;
+        file_header.version = BLOCKLIST_VERSION;
+        file_header.first_head_offset = -1;
+        file_header.last_head_offset = -1;
+        file_header.free_head_offset = -1;
+        file_header.free_body = -1;
+    }
+
+    // 初始化新文件：NodeHead区域紧接文件头，初始容量为INITIAL_HEAD_RESERVE字节
+    void init_new_file() {
+        reset_file_header();
+        file_header.head_start = header_size;
+        file_header.head_capacity = INITIAL_HEAD_RESERVE / head_size;
+        file_header.data_start = file_header.head_start + (long long)file_header.head_capacity * head_size;
+        if (mode == StorageMode::MMAP) {
+            mapped.reserve(file_header.data_start);  // 保证文件头和NodeHead区域已映射
         }
+        // 写入文件头
+        write_file_header();
+    }
 
-        // 更新链表
-        if (right_head.next_offset != -1) {
-            NodeHead<INDEX_LEN> next_head;
-            read_head(next_head, right_head.next_offset);
-            next_head.prev_offset = left_offset;
-            write_head(next_head, right_head.next_offset);
+    // 读入现有文件的文件头和目录，旧格式的文件先升级
+    void open_existing_file() {
+        read_at(0, reinterpret_cast<char*>(&file_header), sizeof(int));
+        if (file_header.magic != BLOCKLIST_MAGIC) {
+            upgrade_legacy();
+            return;
         }
-        else {
-            file_header.last_head_offset = left_offset;
+        read_file_header();
+        if (file_header.version != BLOCKLIST_VERSION) {
+            storage_fatal(filename, "unsupported format version " + to_string(file_header.version));
         }
-        // 写入左块
-        write_head(left_head, left_offset);
-        write_body(left_body, left_head.body_offset);
-
-        // 释放右块的head和body
-        free_head(right_offset);
-        free_body(right_head.body_offset);
+        if (file_header.head_capacity <= 0 || file_header.head_count < 0
+            || file_header.head_count > file_header.head_capacity || file_header.body_count < 0) {
+            storage_fatal(filename, "corrupt file header");
+        }
+        load_directory();
     }
 
-    // 尝试合并块
-    void try_merge_blocks(int head_offset) {
-        NodeHead<INDEX_LEN> head;
-        read_head(head, head_offset);
-
-        if (head.pair_count >= MIN_BLOCK_SIZE) {
-            return;  // 不需要合并
+    // 升级旧格式（版本0）的文件：NodeBody是定长的条目数组，由第一个非空块开头的内容确认
+    void upgrade_legacy() {
+        LegacyFileHeader legacy;
+        read_at(0, reinterpret_cast<char*>(&legacy), sizeof(LegacyFileHeader));
+        long long legacy_head_start = sizeof(LegacyFileHeader);
+        long long legacy_data_start = legacy_head_start + LEGACY_HEAD_RESERVE;
+        long long legacy_head_size = sizeof(LegacyNodeHead<INDEX_LEN>);
+
+        // 不是本格式的文件（或文件头已损坏）时不能当作空文件继续使用
+        if (legacy.count < 0 || legacy.count > LEGACY_HEAD_RESERVE / legacy_head_size
+            || legacy_head_start + legacy.count * legacy_head_size > file_size()) {
+            storage_fatal(filename, "unrecognized file header");
         }
 
-        // 尝试与前面的块合并
-        if (head.prev_offset != -1) {
-            NodeHead<INDEX_LEN> prev_head;
-            read_head(prev_head, head.prev_offset);
-            if (prev_head.pair_count + head.pair_count <= BLOCK_SIZE) {
-                merge_blocks(prev_head, head, head.prev_offset, head_offset);
-                return;
+        vector<LegacyNodeHead<INDEX_LEN>> chain;
+        if (legacy.first_head_offset != -1 && legacy.count > 0) {
+            vector<char> heads(static_cast<size_t>(legacy.count) * legacy_head_size);
+            read_at(legacy_head_start, heads.data(), heads.size());
+            long long current_offset = legacy.first_head_offset;
+            while (current_offset != -1 && (int)chain.size() < legacy.count) {
+                long long relative = current_offset - legacy_head_start;
+                if (relative < 0 || relative % legacy_head_size != 0 || relative / legacy_head_size >= legacy.count) {
+                    storage_fatal(filename, "corrupt block list");
+                }
+                LegacyNodeHead<INDEX_LEN> head;
+                memcpy(&head, heads.data() + relative, sizeof(LegacyNodeHead<INDEX_LEN>));
+                if (head.pair_count < 0) {
+                    storage_fatal(filename, "corrupt block list");
+                }
+                chain.push_back(head);
+                current_offset = head.next_offset;
             }
-        }
-        // 尝试与后面的块合并
-        if (head.next_offset != -1) {
-            NodeHead<INDEX_LEN> next_head;
-            read_head(next_head, head.next_offset);
-            if (head.pair_count + next_head.pair_count <= BLOCK_SIZE) {
-                merge_blocks(head, next_head, head_offset, head.next_offset);
-                return;
+            if (current_offset != -1) {
+                storage_fatal(filename, "corrupt block list");  // 链表成环
             }
         }
+
+        int first = 0;
+        while (first < (int)chain.size() && chain[first].pair_count == 0) {
+            first++;
+        }
+        if (first < (int)chain.size() && !is_plain_body(chain[first], legacy_data_start)) {
+            storage_fatal(filename, "unrecognized block layout");
+        }
+        check_legacy_bodies(chain, legacy_data_start, sizeof(PlainBody));
+        rebuild_plain(chain);
     }
 
-    // 在块中删除条目
-    bool delete_from_block(int head_offset, const char* index, TypeName value) {
-        NodeHead<INDEX_LEN> head;
-        read_head(head, head_offset);
+    // 旧格式的NodeBody位于数据区第一个位置之后，按stride对齐，且完整地在文件中
+    bool legacy_body_fits(long long body_offset, long long legacy_data_start, long long stride) {
+        return body_offset >= legacy_data_start + stride && (body_offset - legacy_data_start) % stride == 0
+               && body_offset + stride <= file_size();
+    }
 
-        NodeBody<INDEX_LEN, TypeName> body;
-        read_body(body, head.body_offset);
+    void check_legacy_bodies(const vector<LegacyNodeHead<INDEX_LEN>>& chain, long long legacy_data_start, long long stride) {
+        for (const auto& head : chain) {
+            if (!legacy_body_fits(head.body_offset, legacy_data_start, stride)) {
+                storage_fatal(filename, "corrupt block list");
+            }
+        }
+    }
 
-        // 二分查找删除位置
-        int left = 0, right = head.pair_count - 1;
-        int delete_pos = -1;
+    // 版本0的块：条目数组的第一个或最后一个键与NodeHead记录的最小、最大键一致
+    bool is_plain_body(const LegacyNodeHead<INDEX_LEN>& head, long long legacy_data_start) {
+        if (head.pair_count <= 0 || head.pair_count > BLOCK_SIZE
+            || !legacy_body_fits(head.body_offset, legacy_data_start, sizeof(PlainBody))) {
+            return false;
+        }
+        Pair first, last;
+        long long pairs = head.body_offset + offsetof(PlainBody, pairs);
+        read_at(pairs, reinterpret_cast<char*>(&first), sizeof(Pair));
+        read_at(pairs + (long long)(head.pair_count - 1) * sizeof(Pair), reinterpret_cast<char*>(&last), sizeof(Pair));
+        return strncmp(first.index, head.min_index, INDEX_LEN) == 0 || strncmp(last.index, head.max_index, INDEX_LEN) == 0;
+    }
 
-        while (left <= right) {
-            int mid = left + (right - left) / 2;
-            int cmp = strcmp(body.pairs[mid].index, index);
-            if (cmp < 0) {
-                left = mid + 1;
+    // 版本0的NodeBody大小不同，无法原地升级：读出全部条目，把原文件改名为备份，按当前格式重建
+    // 重建的文件刷到磁盘后才删除备份；中途退出时下次打开会由备份重新升级（见构造函数）
+    void rebuild_plain(const vector<LegacyNodeHead<INDEX_LEN>>& chain) {
+        vector<pair<string, TypeName>> entries;
+        vector<char> buffer(sizeof(PlainBody));
+        const PlainBody* body = reinterpret_cast<const PlainBody*>(buffer.data());
+        for (const auto& head : chain) {
+            if (head.pair_count > BLOCK_SIZE) {
+                storage_fatal(filename, "corrupt block list");
             }
-            else if (cmp > 0) {
-                right = mid - 1;
+            read_at(head.body_offset, buffer.data(), buffer.size());
+            for (int i = 0; i < head.pair_count; i++) {
+                entries.emplace_back(string(body->pairs[i].index, strnlen(body->pairs[i].index, INDEX_LEN)),
+                                     body->pairs[i].value);
             }
-            else {
-                // 索引相同，查找值
-                if (body.pairs[mid].value < value) {
-                    left = mid + 1;
-                }
-                else if (body.pairs[mid].value > value) {
-                    right = mid - 1;
+        }
+
+        string backup = filename + ".v0";
+        if (mode == StorageMode::MMAP) {
+            mapped.close();
+        }
+        else {
+            data_file.close();
+        }
+        if (std::rename(filename.c_str(), backup.c_str()) != 0) {
+            storage_fatal(filename, "cannot back up the old file for upgrade");
+        }
+        if (mode == StorageMode::MMAP) {
+            mapped.open(filename);
+        }
+        else {
+            data_file.open(filename);
+        }
+        init_new_file();
+        bulk_load(entries.begin(), entries.end());
+        if (mode == StorageMode::MMAP) {
+            mapped.sync();
+        }
+        else {
+            // 重建的内容直接写回原位并刷盘，不必再记入日志
+            write_pending();
+            unlogged_heads.clear();
+            header_unlogged = false;
+            pool->collect(this, [](int, int, const char*, int) {});
+            pool->flush(this);
+            pool->logged(this);
+        }
+        std::remove(backup.c_str());
+    }
+
+public:
+    // 顺序扫描游标：逐块前进，任一时刻只固定当前块的NodeBody
+    // 游标存续期间不能修改BlockList
+    class Cursor {
+        friend class BlockList;
+        BlockList* list;
+        shared_lock<shared_timed_mutex> lock;  // 游标存续期间持有共享锁
+        ScanBound bound;
+        int pos = 0;               // 当前块的目录下标
+        long long body_offset = -1;    // 已固定的NodeBody偏移
+        const Body* body = nullptr;
+        BlockReader reader;        // 块内位置
+
+        Cursor(BlockList* list, const ScanBound& bound) : list(list), lock(list->latch), bound(bound) {}
+
+        void pin() {
+            body_offset = list->directory[pos].body_offset;
+            body = list->pin_body(body_offset);
+            reader = BlockReader(body);
+        }
+
+        void release() {
+            if (body != nullptr) {
+                list->unpin_body(body_offset, false);
+                body = nullptr;
+            }
+        }
+
+        // 跳到下一个有效条目，越过终止条件时结束
+        void settle() {
+            while (pos < (int)list->directory.size()) {
+                if (body == nullptr) {
+                    pin();
                 }
-                else {
-                    delete_pos = mid;
-                    break;
+                if (reader.valid()) {
+                    if (!bound.contains(reader.index)) {
+                        release();
+                        pos = (int)list->directory.size();
+                    }
+                    return;
                 }
+                release();
+                pos++;
             }
         }
 
-        if (delete_pos == -1) {
-            return false;  // 未找到
+    public:
+        Cursor(Cursor&& other) : list(other.list), lock(std::move(other.lock)), bound(other.bound), pos(other.pos),
+                                 body_offset(other.body_offset), body(other.body), reader(other.reader) {
+            other.body = nullptr;
         }
+        Cursor(const Cursor&) = delete;
+        Cursor& operator=(const Cursor&) = delete;
 
-        // 移动元素覆盖要删除的元素
-        for (int i = delete_pos; i < head.pair_count - 1; i++) {
-            body.pairs[i] = body.pairs[i + 1];
+        ~Cursor() {
+            release();
         }
-        head.pair_count--;
-        memset(&body.pairs[head.pair_count], 0, sizeof(KeyValue<INDEX_LEN, TypeName>));
 
-        // 更新索引范围
-        if (head.pair_count > 0) {
-            strncpy(head.min_index, body.pairs[0].index, INDEX_LEN - 1);
-            strncpy(head.max_index, body.pairs[head.pair_count - 1].index, INDEX_LEN - 1);
-            head.min_index[INDEX_LEN - 1] = '\0';
-            head.max_index[INDEX_LEN - 1] = '\0';
+        bool valid() const {
+            return body != nullptr;
         }
-        else {
-            // 块为空
-            head.min_index[0] = '\0';
-            head.max_index[0] = '\0';
+
+        const char* index() const {
+            return reader.index;
         }
 
-        // 写回
-        write_head(head, head_offset);
-        write_body(body, head.body_offset);
+        const TypeName& value() const {
+            return reader.value();
+        }
 
-        return true;
-    }
+        void next() {
+            reader.next();
+            settle();
+        }
+    };
 
-    // 初始化新文件
-    void init_new_file() {
-        // 初始化文件头
-        memset(&file_header, 0, sizeof(FileHeader));
-        file_header.first_head_offset = -1;
-        file_header.last_head_offset = -1;
-        file_header.free_head_offset = -1;
-        file_header.free_body_offset = -1;
-        file_header.count = 0;
-        // 写入文件头
-        write_file_header();
+private:
+    // 定位到第一个index不小于给定值的条目
+    Cursor seek(const char* index, const ScanBound& bound) {
+        Cursor cursor(this, bound);
+        cursor.pos = lower_block(index);
+        if (cursor.pos < (int)directory.size()) {
+            cursor.pin();
+            cursor.reader.seek(index);
+        }
+        cursor.settle();
+        return cursor;
     }
 
 public:
     BlockList() = default;
-    explicit BlockList(const string& filename) {
+    explicit BlockList(const string& filename, StorageMode mode = StorageMode::STREAM) : mode(mode) {
         header_size = sizeof(FileHeader);
         head_size = sizeof(NodeHead<INDEX_LEN>);
-        body_size = sizeof(int32_t) + BLOCK_SIZE * sizeof(KeyValue<INDEX_LEN, TypeName>);
-
-        // 计算各个区域的起始偏移
-        head_start = header_size;
-        data_start = head_start + MAX_HEAD_RESERVE;
+        body_size = sizeof(Body);
 
         this->filename = filename;
 
+        // 上次由版本0重建时中途退出：原文件还在备份中，丢掉重建了一半的文件，重新升级
+        string backup = filename + ".v0";
+        if (ifstream(backup).good()) {
+            std::rename(backup.c_str(), filename.c_str());
+        }
+
+        // 新文件按当前格式初始化；旧格式的文件头只有32字节，按其大小判断文件是否为空
+        if (mode == StorageMode::MMAP) {
+            mapped.open(filename);
+            if (mapped.size() < sizeof(LegacyFileHeader)) {
+                init_new_file();
+            }
+            else {
+                open_existing_file();
+            }
+            load_filters();
+            return;
+        }
+
         // 打开或创建文件
-        data_file.open(filename, ios::in | ios::out | ios::binary);
-        if (!data_file.is_open() || data_file.peek() == EOF) {
-            // 文件不存在，创建新文件
-            data_file.close();
-            data_file.open(filename, ios::out | ios::binary);
-            data_file.close();
-            data_file.open(filename, ios::in | ios::out | ios::binary);
-            // 初始化新文件
+        data_file.open(filename);
+        if (data_file.size() < (long long)sizeof(LegacyFileHeader)) {
+            // 新文件
             init_new_file();
         }
         else {
-            // 读取现有文件头
-            read_file_header();
+            // 读取现有文件头，旧格式就地升级
+            open_existing_file();
         }
+        pool->attach(this);
+        journal->attach(this);
+        load_filters();
     }
 
     ~BlockList() {
-        if (data_file.is_open()) {
-            data_file.close();
+        if (!filename.empty()) {
+            filters.save(filename + ".bloom", directory_stamp());
+        }
+        if (mode == StorageMode::MMAP) {
+            mapped.close();  // 关闭前msync
+            return;
         }
+        // 写回尚未落盘的NodeHead和缓冲池中属于本文件的脏页
+        write_pending();
+        pool->detach(this);
+        journal->detach(this);
+        truncate_tail();
+        data_file.close();
+    }
+
+    // 缓冲池缺页时按编号读入NodeBody（可能由多个读线程同时调用）
+    void read_page(int number, char* data, int size) override {
+        data_file.read(body_at(number), data, size);
+    }
+
+    // 缓冲池按编号写回NodeBody
+    void write_page(int number, const char* data, int size) override {
+        data_file.write(body_at(number), data, size);
+    }
+
+    void sync() override {
+        data_file.sync();
+    }
+
+    bool journaled() const override {
+        return true;
+    }
+
+    // 把本次指令修改过的文件头、NodeHead和NodeBody交给日志
+    void prepare_commit() override {
+        lock_guard<shared_timed_mutex> guard(latch);
+        if (header_unlogged) {
+            journal->record(filename, 0, reinterpret_cast<const char*>(&file_header), sizeof(FileHeader));
+            header_unlogged = false;
+        }
+        for (long long offset : unlogged_heads) {
+            journal->record(filename, offset, reinterpret_cast<const char*>(&pending_heads[offset]),
+                            sizeof(NodeHead<INDEX_LEN>));
+        }
+        unlogged_heads.clear();
+        pool->collect(this, [this](int number, int begin, const char* data, int size) {
+            journal->record(filename, body_at(number) + begin, data, size);
+        });
+    }
+
+    // 日志落盘后，交出的页面才可以被淘汰写回
+    void committed() override {
+        lock_guard<shared_timed_mutex> guard(latch);
+        pool->logged(this);
+    }
+
+    // 检查点：把已提交的修改全部写回原位
+    void checkpoint() override {
+        lock_guard<shared_timed_mutex> guard(latch);
+        write_pending();
+        pool->flush(this);
+        truncate_tail();
+    }
+
+    // 写回本文件的全部修改（MMAP模式下msync）
+    void flush() {
+        if (mode == StorageMode::MMAP) {
+            lock_guard<shared_timed_mutex> guard(latch);
+            mapped.sync();
+            return;
+        }
+        checkpoint();
     }
 
     // 插入操作
     void insert(const char* index, TypeName value) {
-        // 查找合适的块
-        int target_offset = find_suitable_block(index);
+        lock_guard<shared_timed_mutex> guard(latch);
+        insert_entry(index, value);
+    }
 
-        // 处理数据库为空的情况
-        if (target_offset == -1) {
-            // 需要插入在第一个块之前
-            target_offset = create_new_block(-1);
-            insert_to_block(target_offset, index, value);
-            write_file_header();
+    // 批量装载(index, value)条目，元素类型为pair<string, TypeName>
+    // 表为空时按顺序整块写入，每块写到容量的fill_factor为止，未排序的输入先在内存中排序
+    // 表非空时退化为逐条插入
+    template<typename Iterator>
+    void bulk_load(Iterator begin, Iterator end, double fill_factor = 1.0) {
+        lock_guard<shared_timed_mutex> guard(latch);
+        if (!directory.empty()) {
+            for (Iterator it = begin; it != end; ++it) {
+                insert_entry(it->first.c_str(), it->second);
+            }
             return;
         }
 
-        // 读取目标块的信息
-        NodeHead<INDEX_LEN> target_head;
-        read_head(target_head, target_offset);
+        // 至少能放下一个最长的条目
+        int longest = 2 + INDEX_LEN + (int)sizeof(TypeName) + RESTART_BYTES;
+        int limit = max(longest, min((int)BODY_BYTES, static_cast<int>(BODY_BYTES * fill_factor)));
+        if (is_sorted(begin, end, pair_less)) {
+            load_sorted(begin, end, limit);
+        }
+        else {
+            vector<pair<string, TypeName>> sorted(begin, end);
+            sort(sorted.begin(), sorted.end(), pair_less);
+            load_sorted(sorted.begin(), sorted.end(), limit);
+        }
+    }
 
-        // 检查是否需要分裂
-        if (target_head.pair_count >= BLOCK_SIZE) {
-            split_block(target_offset);
-            // 分裂后重新查找合适的块
-            target_offset = find_suitable_block(index);
-            if (target_offset == -1) {
-                target_offset = create_new_block(-1);
+    // 增量整理：从上次的位置起处理至多budget个块，把不满的块填满，并把NodeHead和NodeBody
+    // 移到按目录顺序排列的位置，之后的扫描变为顺序读；全部就位后回收空闲块，返回是否已整理完毕
+    // 不需要整理时直接返回true
+    bool vacuum(int budget) {
+        lock_guard<shared_timed_mutex> guard(latch);
+        if (vacuum_pos == -1) {
+            if (!fragmented()) {
+                return true;
             }
+            vacuum_pos = 0;
         }
-
-        bool success = insert_to_block(target_offset, index, value);
-        if (!success) {  // 有相同项不插入
-                return;
+        for (; budget > 0 && vacuum_pos < (int)directory.size(); budget--, vacuum_pos++) {
+            pack_block(vacuum_pos);
+            // 空闲链表上的块（包括刚合并释放的）不再复用，整理完成时统一回收
+            file_header.free_head_offset = -1;
+            file_header.free_body = -1;
+            place_block(vacuum_pos);
+        }
+        write_file_header();
+        if (vacuum_pos < (int)directory.size()) {
+            return false;
         }
 
+        // 两步之间的插入删除可能移动已就位的块，从第一个不在位置上的块继续
+        for (int i = 0; i < (int)directory.size(); i++) {
+            if (directory[i].head_offset != sequential_head(i) || directory[i].body_offset != sequential_body(i)) {
+                vacuum_pos = i;
+                return false;
+            }
+        }
+        // NodeBody编号数截到最后一个块为止；NodeHead区域在所有块之后时，放得下就搬回数据区之前，
+        // 否则紧接最后一个块，文件才能截短
+        int blocks = (int)directory.size();
+        int front = static_cast<int>((file_header.data_start - header_size) / head_size);
+        file_header.head_count = blocks;
+        file_header.body_count = blocks > 0 ? body_number(sequential_body(blocks - 1)) + 1 : 0;
+        if (head_run_count() > 0 && head_run_first() >= blocks) {
+            file_header.body_count = blocks;
+            if (blocks < front) {
+                relocate_heads(header_size, front);
+            }
+            else {
+                relocate_heads(body_at(blocks), file_header.head_capacity);
+            }
+        }
+        else if (head_run_count() > 0) {
+            file_header.body_count = max(file_header.body_count, head_run_first() + head_run_count());
+        }
         write_file_header();
+        truncate_pending = mode == StorageMode::STREAM;
+        vacuum_pos = -1;
+        return true;
     }
 
     // 删除操作
     void remove(const char* index, TypeName value) {
-        int current_offset = find_first_block_by_index(index);
-
-        while (current_offset != -1) {
-            NodeHead<INDEX_LEN> current_head;
-            read_head(current_head,current_offset);
-
-            // 如果index超出当前块范围，停止查找
-            if (strcmp(index, current_head.min_index) < 0) {
+        lock_guard<shared_timed_mutex> guard(latch);
+        int pos = lower_block(index);
+
+        // 依次检查min_index <= index的块，布隆过滤器排除的块不读
+        while (pos < (int)directory.size() && strcmp(directory[pos].min_index, index) <= 0) {
+            if (filters.may_contain(body_number(directory[pos].body_offset), index)
+                && delete_from_block(pos, index, value)) {
+                try_merge_blocks(pos);
                 break;
             }
-
-            if (strcmp(index, current_head.min_index) >= 0 && strcmp(index, current_head.max_index) <= 0) {
-                // 尝试在当前块中删除
-                bool deleted = delete_from_block(current_offset, index, value);
-                if (deleted) {
-
-                        try_merge_blocks(current_offset);
-
-                    write_file_header();
-                    return;
-                }
-            }
-            // 继续查找下一个块
-            current_offset = current_head.next_offset;
+            pos++;
         }
         write_file_header();
     }
 
-    // 查找操作
+    // 查找操作，可与其他线程的查找并发
     vector<TypeName> find(const char* index) {
+        shared_lock<shared_timed_mutex> guard(latch);
         vector<TypeName> result;
         // 查找第一个可能包含该index的块
-        int current_offset = find_first_block_by_index(index);
+        int pos = lower_block(index);
 
-        while (current_offset != -1) {
-            NodeHead<INDEX_LEN> current_head;
-            read_head(current_head, current_offset);
-            // 如果index超出范围，停止查找
-            if (strcmp(index, current_head.min_index) < 0) {
-                break;
+        while (pos < (int)directory.size() && strcmp(directory[pos].min_index, index) <= 0) {
+            const BlockEntry<INDEX_LEN>& entry = directory[pos];
+            if (!filters.may_contain(body_number(entry.body_offset), index)) {
+                pos++;  // 布隆过滤器排除的块不读
+                continue;
             }
-
-            if (strcmp(index, current_head.min_index) >= 0 && strcmp(index, current_head.max_index) <= 0) {
-                // 在这个块中查找
-                NodeBody<INDEX_LEN, TypeName> current_body;
-                read_body(current_body, current_head.body_offset);
-                for (int i = 0; i < current_head.pair_count; i++) {
-                    if (strcmp(current_body.pairs[i].index, index) == 0) {
-                        result.push_back(current_body.pairs[i].value);
-                    }
-                    else if (strcmp(current_body.pairs[i].index, index) > 0) {
-                        // 块内是有序的，可以提前结束
-                        break;
-                    }
-                }
+            // 在这个块中经重启点二分定位，再顺序收集
+            BlockReader reader(pin_body(entry.body_offset));
+            for (reader.seek(index); reader.valid() && strcmp(reader.index, index) == 0; reader.next()) {
+                result.push_back(reader.value());
             }
+            unpin_body(entry.body_offset, false);
             // 继续下一个块
-            current_offset = current_head.next_offset;
+            pos++;
         }
 
         // 排序结果
@@ -764,33 +1761,38 @@ public:
         return result;
     }
 
-    // 新增：获取全部元素
-    std::vector<TypeName> get_all() {
-        std::vector<TypeName> result;
+    // 从第一个index不小于给定值的条目开始扫描到末尾
+    Cursor lower_bound(const char* index) {
+        return seek(index, ScanBound());
+    }
 
-        // 从头节点开始遍历
-        int current_offset = file_header.first_head_offset;
+    // 扫描所有以prefix开头的条目
+    Cursor prefix(const char* prefix) {
+        return seek(prefix, ScanBound(ScanBound::PREFIX, prefix));
+    }
 
-        while (current_offset != -1) {
-            NodeHead<INDEX_LEN> current_head;
-            read_head(current_head, current_offset);
+    // 扫描index在[low, high]中的条目
+    Cursor range(const char* low, const char* high) {
+        return seek(low, ScanBound(ScanBound::UPPER, high));
+    }
 
-            if (current_head.pair_count > 0) {
-                NodeBody<INDEX_LEN, TypeName> current_body;
-                read_body(current_body, current_head.body_offset);
+    // 新增：获取全部元素
+    std::vector<TypeName> get_all() {
+        shared_lock<shared_timed_mutex> guard(latch);
+        std::vector<TypeName> result;
 
+        // 按目录顺序遍历所有块
+        for (const auto& entry : directory) {
+            if (entry.pair_count > 0) {
                 // 将当前块中的所有元素添加到结果中
-                for (int i = 0; i < current_head.pair_count; i++) {
-                    result.push_back(current_body.pairs[i].value);
+                for (BlockReader reader(pin_body(entry.body_offset)); reader.valid(); reader.next()) {
+                    result.push_back(reader.value());
                 }
+                unpin_body(entry.body_offset, false);
             }
-
-            // 移动到下一个块
-            current_offset = current_head.next_offset;
         }
 
-        // 按索引排序
         return result;
     }
 };
-#endif //BOOKSTORE_2025_STORAGE_H
\ No newline at end of file
+#endif //BOOKSTORE_2025_STORAGE_H
@@ -0,0 +1,46 @@
+#ifndef BOOKSTORE_2025_STRINGDICTIONARY_H
+#define BOOKSTORE_2025_STRINGDICTIONARY_H
+#include <string>
+#include <vector>
+#include "Index.h"
+#include "RecordCache.h"
+#include "SlottedStore.h"
+
+const int DICTIONARY_STRING_LEN = 61;  // 字典中字符串的最大长度（含结尾0）
+const int DICTIONARY_KEY_LEN = 9;      // id_key的长度（8位十六进制和结尾0）
+
+// 持久化的字符串字典：每个不同的字符串对应一个32位编号（从1开始，0表示空串或不存在）
+// 字符串 -> 编号是一个有序索引，支持按前缀列出；编号 -> 字符串存在SlottedStore中（编号即记录编号）
+// 只增不删：不再使用的字符串仍保留其编号
+class StringDictionary {
+private:
+    IndexEngine<DICTIONARY_STRING_LEN, int> ids;  // 字符串 -> 编号
+    SlottedStore strings;                         // 编号 -> 字符串
+    RecordCache<std::string> cache;               // 最近查过的编号 -> 字符串
+
+public:
+    // index_name为字符串索引文件，page_name、slot_name为SlottedStore的两个文件
+    StringDictionary(const std::string& index_name, const std::string& page_name, const std::string& slot_name);
+
+    // 已分配的编号数
+    int size() const {
+        return strings.size();
+    }
+
+    // 字符串的编号，不存在或为空串时返回0
+    int find(const std::string& s);
+
+    // 字符串的编号，不存在时分配新编号；空串返回0
+    int intern(const std::string& s);
+
+    // 编号对应的字符串，0或不存在的编号返回空串
+    std::string lookup(int id);
+
+    // 以prefix开头的全部字符串的编号，按字符串顺序
+    std::vector<int> prefix(const std::string& prefix);
+
+    // 编号的定长键（8位十六进制），用作以编号为键的索引的键，字典序与编号大小一致
+    static std::string id_key(int id);
+};
+
+#endif //BOOKSTORE_2025_STRINGDICTIONARY_H
@@ -3,6 +3,13 @@
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <fstream>
+
+static const int VACUUM_BUDGET = 16;  // 每条指令后最多搬移的账户数
+static const int ACCOUNT_CACHE_RECORDS = 256;  // 账户记录缓存的容量
+static const int FREE_LIST_INFO = 1;  // 账户数据文件中保存空闲链表表头的info
+static const char* const LEGACY_ACCOUNT_INDEX = "account_index.dat";  // 改用哈希索引之前的有序账户索引
 
 void AccountSystem::init_root() {
     Account root;
@@ -11,11 +18,28 @@ void AccountSystem::init_root() {
     strcpy(root.Username, "Adiministrator");
     root.Privilege = 7;
     // 写入文件
-    int pos = accountStorage.write(root);
+    long long pos = accountStorage.write(root);
     // 建立索引
     accountIndex.insert(root.UserID, pos);
 }
 
+// 已有账户数据而哈希索引为空：由旧的有序索引补建，提交后删除旧文件
+// 旧索引也不存在时无法找回已有的账户，不能继续（否则会再追加一个root）
+void AccountSystem::migrate_account_index() {
+    if (!std::ifstream(LEGACY_ACCOUNT_INDEX).good()) {
+        storage_fatal("account_hash.dat", "account index is missing but account data exists");
+    }
+    {
+        IndexEngine<31, int> legacy(LEGACY_ACCOUNT_INDEX);
+        for (auto cursor = legacy.lower_bound(""); cursor.valid(); cursor.next()) {
+            accountIndex.insert(cursor.index(), cursor.value());
+        }
+    }
+    Journal::shared().commit();
+    std::remove(LEGACY_ACCOUNT_INDEX);
+    std::remove((std::string(LEGACY_ACCOUNT_INDEX) + ".bloom").c_str());
+}
+
 bool AccountSystem::ID_pw_check(const std::string& s) const {
     // 长度检查
     if (s.empty() || s.length() > 30) return false;
@@ -82,14 +106,19 @@ bool AccountSystem::get_user_info(const std::string& UserID, Account& account) {
     if (result.empty()) {
         return false;
     }
-    int pos = result[0];
+    long long pos = result[0];
     accountStorage.read(account, pos);
     return true;
 }
 
 AccountSystem::AccountSystem()
-    : accountIndex("account_index.dat") {
+    : accountIndex("account_hash.dat") {
     accountStorage.initialise("account_data.dat");
+    accountStorage.set_cache_capacity(ACCOUNT_CACHE_RECORDS);
+    accountStorage.reuse_space(FREE_LIST_INFO);
+    if (accountIndex.size() == 0 && accountStorage.capacity() > 0) {
+        migrate_account_index();
+    }
 
     // 检查是否需要初始化根用户
     if (!user_exist("root")) {
@@ -169,7 +198,7 @@ void AccountSystem::regis(const string& UserID, const string& Password, const st
     new_account.Privilege = 1; // 注册账户权限固定为1
 
     // 存储账户
-    int pos = accountStorage.write(new_account);
+    long long pos = accountStorage.write(new_account);
     accountIndex.insert(UserID.c_str(), pos);
 }
 
@@ -211,7 +240,7 @@ void AccountSystem::passwd(const string& UserID, const string& NewPassword, cons
 
     // 更新存储
     auto result = accountIndex.find(UserID.c_str());
-    int pos = result[0];
+    long long pos = result[0];
     accountStorage.update(account, pos);
 }
 
@@ -254,7 +283,7 @@ void AccountSystem::useradd(const string& UserID, const string& Password, int Pr
     strcpy(new_account.Username, Username.c_str());
     new_account.Privilege = Privilege;
     // 存储账户
-    int pos = accountStorage.write(new_account);
+    long long pos = accountStorage.write(new_account);
     accountIndex.insert(UserID.c_str(), pos);
 }
 
@@ -289,8 +318,24 @@ void AccountSystem::deleteAccount(const string& UserID) {
     }
     // 删除账户
     auto result = accountIndex.find(UserID.c_str());
-    int pos = result[0];
+    long long pos = result[0];
     accountIndex.remove(UserID.c_str(), pos);
+    accountStorage.Delete(pos);
+}
 
-    // 存储中的空间回收待实现
+// 增量压缩账户数据：空位较多时开始，每次只搬移少量账户并更新索引中的位置
+void AccountSystem::vacuum() {
+    if (!accountStorage.compacting()) {
+        if (!accountStorage.sparse(accountIndex.size())) {
+            return;
+        }
+        std::vector<long long> live = accountIndex.get_all();
+        accountStorage.begin_compact(live);
+    }
+    accountStorage.compact(VACUUM_BUDGET, [this](long long from, long long to) {
+        Account account;
+        accountStorage.read(account, to);
+        accountIndex.remove(account.UserID, from);
+        accountIndex.insert(account.UserID, to);
+    });
 }
@@ -0,0 +1,119 @@
+#include "BloomFilter.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+static const uint32_t BLOOM_MAGIC = 0x4D4F4C42;  // "BLOM"
+
+BloomFilter::BloomFilter(int bits_per_block) : words_per_block((bits_per_block + 63) / 64) {
+    if (words_per_block < 1) {
+        words_per_block = 1;
+    }
+}
+
+// FNV-1a后再做一次混合，高低32位分别作为两个基础哈希
+uint64_t BloomFilter::hash(const char* key) {
+    uint64_t h = 14695981039346656037ull;
+    for (const unsigned char* p = reinterpret_cast<const unsigned char*>(key); *p != 0; p++) {
+        h ^= *p;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+void BloomFilter::reserve(int block) {
+    size_t need = static_cast<size_t>(block + 1) * words_per_block;
+    if (bits.size() < need) {
+        bits.resize(need, 0);
+    }
+}
+
+void BloomFilter::clear(int block) {
+    reserve(block);
+    std::fill(bits.begin() + static_cast<size_t>(block) * words_per_block,
+              bits.begin() + static_cast<size_t>(block + 1) * words_per_block, 0);
+}
+
+void BloomFilter::add(int block, const char* key) {
+    reserve(block);
+    uint64_t h = hash(key);
+    uint32_t h1 = static_cast<uint32_t>(h), h2 = static_cast<uint32_t>(h >> 32) | 1;
+    uint64_t* words = bits.data() + static_cast<size_t>(block) * words_per_block;
+    uint32_t bit_count = static_cast<uint32_t>(words_per_block) * 64;
+    for (int i = 0; i < HASH_COUNT; i++) {
+        uint32_t bit = (h1 + i * h2) % bit_count;
+        words[bit / 64] |= 1ull << (bit % 64);
+    }
+}
+
+void BloomFilter::swap(int a, int b) {
+    reserve(std::max(a, b));
+    std::swap_ranges(bits.begin() + static_cast<size_t>(a) * words_per_block,
+                     bits.begin() + static_cast<size_t>(a + 1) * words_per_block,
+                     bits.begin() + static_cast<size_t>(b) * words_per_block);
+}
+
+void BloomFilter::move(int from, int to) {
+    clear(to);
+    swap(from, to);
+}
+
+bool BloomFilter::may_contain(int block, const char* key) const {
+    if (static_cast<size_t>(block + 1) * words_per_block > bits.size()) {
+        return false;  // 从未加入过
+    }
+    uint64_t h = hash(key);
+    uint32_t h1 = static_cast<uint32_t>(h), h2 = static_cast<uint32_t>(h >> 32) | 1;
+    const uint64_t* words = bits.data() + static_cast<size_t>(block) * words_per_block;
+    uint32_t bit_count = static_cast<uint32_t>(words_per_block) * 64;
+    for (int i = 0; i < HASH_COUNT; i++) {
+        uint32_t bit = (h1 + i * h2) % bit_count;
+        if ((words[bit / 64] & (1ull << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BloomFilter::load(const std::string& filename, uint64_t stamp) {
+    bits.clear();
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    uint32_t magic;
+    int32_t words;
+    uint64_t saved_stamp, size;
+    bool valid = in.read(reinterpret_cast<char*>(&magic), sizeof(magic))
+                 && in.read(reinterpret_cast<char*>(&words), sizeof(words))
+                 && in.read(reinterpret_cast<char*>(&saved_stamp), sizeof(saved_stamp))
+                 && in.read(reinterpret_cast<char*>(&size), sizeof(size))
+                 && magic == BLOOM_MAGIC && words == words_per_block && saved_stamp == stamp;
+    if (valid) {
+        bits.resize(size);
+        valid = static_cast<bool>(in.read(reinterpret_cast<char*>(bits.data()), size * sizeof(uint64_t)));
+    }
+    in.close();
+    // 之后的修改不会同步到文件，删除它以免异常退出后读到过期的位图
+    std::remove(filename.c_str());
+
+    if (!valid) {
+        bits.clear();
+    }
+    return valid;
+}
+
+void BloomFilter::save(const std::string& filename, uint64_t stamp) const {
+    std::ofstream out(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    uint64_t size = bits.size();
+    int32_t words = words_per_block;
+    out.write(reinterpret_cast<const char*>(&BLOOM_MAGIC), sizeof(BLOOM_MAGIC));
+    out.write(reinterpret_cast<const char*>(&words), sizeof(words));
+    out.write(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char*>(bits.data()), size * sizeof(uint64_t));
+}
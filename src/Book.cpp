@@ -5,19 +5,282 @@
 #include <vector>
 #include <sstream>
 #include <iomanip>
+#include <fstream>
+#include <cstdio>
+#include <map>
+
+static const int SHOW_BATCH = 512;  // show每批读取的图书数
+static const int VACUUM_BLOCKS = 2;  // 每条指令后每个索引最多整理的块数
+static const int STOCK_CACHE_RECORDS = 4096;  // 图书数值记录缓存的容量（记录只有24字节，多缓存一些）
+static const char* const LEGACY_BOOK_DATA = "book_data.dat";  // 冷热拆分之前整本存储的图书数据
+static const char* const LEGACY_KEYWORD_INDEX = "keyword_index.dat";  // 以关键词为键的索引
+static const char* const LEGACY_AUTHOR_INDEX = "author_index.dat";    // 以作者名为键的索引
+static const unsigned char RAW_KEYWORDS = 0xFF;  // 记录中关键词个数处为此值时，关键词按原串保存
+
+// 价格索引的键：非负double的位模式按无符号整数比较与数值大小一致，写成定长十六进制后按字典序比较即为价格顺序
+// 后接ISBN使每本书的键互不相同（同一键的条目多时BlockList只能逐块查找），同价格的图书按ISBN排列
+static std::string price_key(double price, const char* ISBN) {
+    uint64_t bits;
+    std::memcpy(&bits, &price, sizeof(bits));
+    char key[PRICE_KEY_LEN];
+    std::snprintf(key, sizeof(key), "%016llx%s", static_cast<unsigned long long>(bits), ISBN);
+    return key;
+}
+
+// 分割关键词字符串
+static std::vector<std::string> split_keywords(const std::string& keyword_str) {
+    std::vector<std::string> keywords;
+    std::string current;
+
+    for (char c : keyword_str) {
+        if (c == '|') {
+            if (!current.empty()) {
+                keywords.push_back(current);
+                current.clear();
+            }
+        }
+        else {
+            current += c;
+        }
+    }
+
+    if (!current.empty()) {
+        keywords.push_back(current);
+    }
+    return keywords;
+}
 
 BookSystem::BookSystem(AccountSystem* as, LogSystem* ls)
-    : accountSystem(as), logSystem(ls), selected(false),
+    : bookStorage("book_pages.dat", "book_slots.dat"),
+      dictionary("string_index.dat", "string_pages.dat", "string_slots.dat"),
+      accountSystem(as), logSystem(ls), selected(false),
       ISBNIndex("ISBN_index.dat"),
+      ISBNHash("ISBN_hash.dat"),
       nameIndex("name_index.dat"),
-      authorIndex("author_index.dat"),
-      keywordIndex("keyword_index.dat") {
+      authorIndex("author_id_index.dat"),
+      keywordIndex("keyword_id_dict.dat", "keyword_id_postings.dat"),
+      priceIndex("price_index.dat") {
     std::memset(selected_ISBN, 0, sizeof(selected_ISBN));
-    bookStorage.initialise("book_data.dat");
+    stockStorage.initialise("book_stock.dat");
+    stockStorage.set_cache_capacity(STOCK_CACHE_RECORDS);
+    migrate_author_index();
+    migrate_book_data();
+
+    // 有图书数据而ISBN索引为空时重建索引；只缺哈希索引时由ISBN索引补建
+    if (bookStorage.size() > 0 && !ISBNIndex.lower_bound("").valid()) {
+        rebuild_indexes();
+    }
+    else if (ISBNHash.size() == 0) {
+        for (auto cursor = ISBNIndex.lower_bound(""); cursor.valid(); cursor.next()) {
+            ISBNHash.insert(cursor.index(), cursor.value());
+        }
+    }
+    // 价格索引是后加的：为空而已有图书时由ISBN索引和图书数据补建
+    if (!priceIndex.lower_bound("").valid() && ISBNHash.size() > 0) {
+        std::vector<BookIndex> all = ISBNIndex.get_all();
+        std::vector<int> positions;
+        positions.reserve(all.size());
+        for (const auto& idx : all) {
+            positions.push_back(idx.storage_pos);
+        }
+        std::vector<Book> books;
+        read_books(positions, books);
+        std::vector<std::pair<std::string, BookIndex>> entries;
+        for (size_t i = 0; i < books.size(); i++) {
+            entries.emplace_back(price_key(books[i].Price, books[i].ISBN), all[i]);
+        }
+        priceIndex.bulk_load(entries.begin(), entries.end());
+    }
+    migrate_string_indexes();
 }
 
 BookSystem::~BookSystem() = default;
 
+// 第id个数值记录
+long long BookSystem::stock_pos(int id) {
+    return 2 * sizeof(double) + (id - 1) * static_cast<long long>(sizeof(BookStock));
+}
+
+static void put_string(std::string& record, const char* s) {
+    size_t length = std::strlen(s);
+    record.push_back(static_cast<char>(length));
+    record.append(s, length);
+}
+
+static void put_id(std::string& record, int id) {
+    record.append(reinterpret_cast<const char*>(&id), sizeof(id));
+}
+
+// 从record的at处读出1字节长度加内容到field（field有size字节），越界时读出空串
+static void get_string(const std::string& record, size_t& at, char* field, size_t size) {
+    std::memset(field, 0, size);
+    if (at >= record.size()) {
+        return;
+    }
+    size_t length = std::min(static_cast<size_t>(static_cast<unsigned char>(record[at])), size - 1);
+    std::memcpy(field, record.data() + at + 1, std::min(length, record.size() - at - 1));
+    at += 1 + length;
+}
+
+static int get_id(const std::string& record, size_t& at) {
+    int id = 0;
+    if (at + sizeof(id) <= record.size()) {
+        std::memcpy(&id, record.data() + at, sizeof(id));
+    }
+    at += sizeof(id);
+    return id;
+}
+
+// 关键词按|重新拼接后与原串相同时存各关键词的编号，否则（有空段）存原串
+std::string BookSystem::encode_text(const Book& book) {
+    std::string record(1, '\0');
+    put_string(record, book.ISBN);
+    put_string(record, book.BookName);
+    put_id(record, dictionary.intern(book.Author));
+    std::vector<std::string> keywords = split_keywords(book.Keyword);
+    std::string joined;
+    for (const auto& keyword : keywords) {
+        joined += (joined.empty() ? "" : "|") + keyword;
+    }
+    if (joined == book.Keyword) {
+        record.push_back(static_cast<char>(keywords.size()));
+        for (const auto& keyword : keywords) {
+            put_id(record, dictionary.intern(keyword));
+        }
+    }
+    else {
+        record.push_back(static_cast<char>(RAW_KEYWORDS));
+        put_string(record, book.Keyword);
+    }
+    return record;
+}
+
+void BookSystem::decode_text(const std::string& record, Book& book) {
+    size_t at = 1;  // 跳过格式版本字节
+    get_string(record, at, book.ISBN, sizeof(book.ISBN));
+    get_string(record, at, book.BookName, sizeof(book.BookName));
+    std::string author = dictionary.lookup(get_id(record, at));
+    std::memset(book.Author, 0, sizeof(book.Author));
+    std::strncpy(book.Author, author.c_str(), sizeof(book.Author) - 1);
+    unsigned char count = at < record.size() ? static_cast<unsigned char>(record[at]) : 0;
+    at++;
+    if (count == RAW_KEYWORDS) {
+        get_string(record, at, book.Keyword, sizeof(book.Keyword));
+        return;
+    }
+    std::string keywords;
+    for (int i = 0; i < count; i++) {
+        keywords += (i == 0 ? "" : "|") + dictionary.lookup(get_id(record, at));
+    }
+    std::memset(book.Keyword, 0, sizeof(book.Keyword));
+    std::strncpy(book.Keyword, keywords.c_str(), sizeof(book.Keyword) - 1);
+}
+
+std::string BookSystem::string_key(const std::string& s, bool intern) {
+    return StringDictionary::id_key(intern ? dictionary.intern(s) : dictionary.find(s));
+}
+
+void BookSystem::read_book(Book& book, int pos) {
+    std::string text;
+    BookStock stock;
+    bookStorage.read(pos, text);
+    stockStorage.read(stock, stock_pos(pos));
+    decode_text(text, book);
+    book.Stock = stock.Stock;
+    book.Price = stock.Price;
+    book.TotalCost = stock.TotalCost;
+}
+
+void BookSystem::read_books(const std::vector<int>& positions, std::vector<Book>& books) {
+    std::vector<long long> stock_positions;
+    stock_positions.reserve(positions.size());
+    for (int pos : positions) {
+        stock_positions.push_back(stock_pos(pos));
+    }
+    std::vector<std::string> texts;
+    std::vector<BookStock> stocks;
+    bookStorage.read_many(positions, texts);
+    stockStorage.read_many(stock_positions, stocks);
+    books.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+        Book& book = books[i];
+        decode_text(texts[i], book);
+        book.Stock = stocks[i].Stock;
+        book.Price = stocks[i].Price;
+        book.TotalCost = stocks[i].TotalCost;
+    }
+}
+
+// 文本记录分配编号，数值记录写到对应位置
+int BookSystem::write_book(const Book& book) {
+    int id = bookStorage.insert(encode_text(book));
+    BookStock stock;
+    stock.Stock = book.Stock;
+    stock.Price = book.Price;
+    stock.TotalCost = book.TotalCost;
+    stockStorage.update(stock, stock_pos(id));
+    return id;
+}
+
+void BookSystem::update_book(const Book& book, int pos) {
+    bookStorage.update(pos, encode_text(book));
+    BookStock stock;
+    stock.Stock = book.Stock;
+    stock.Price = book.Price;
+    stock.TotalCost = book.TotalCost;
+    stockStorage.update(stock, stock_pos(pos));
+}
+
+// 旧格式（整本定长记录）的图书数据文件存在时按位置升序把图书逐本写入变长记录存储，编号从1起依次分配，提交后删除旧文件
+// 有索引时随之把各索引中的位置改为编号；编号小于任何旧位置，按位置升序搬移不会与尚未搬移的图书冲突
+// 书名、作者索引可能含有旧ISBN或未删除的旧条目，全部写完后整体扫描改写；关键词索引随后由migrate_string_indexes重建
+// 索引为空时只搬数据，之后由rebuild_indexes重建
+void BookSystem::migrate_book_data() {
+    if (!std::ifstream(LEGACY_BOOK_DATA).good()) {
+        return;
+    }
+    MemoryRiver<Book> legacy_books;
+    legacy_books.initialise(LEGACY_BOOK_DATA);
+    long long record_size = sizeof(Book);
+    long long length = legacy_books.length();
+    long long base = 2 * sizeof(double);
+
+    std::vector<int> positions;
+    for (auto cursor = ISBNIndex.lower_bound(""); cursor.valid(); cursor.next()) {
+        positions.push_back(cursor.value().storage_pos);
+    }
+    bool relocating = !positions.empty();
+    if (!relocating) {
+        for (long long pos = base; pos + record_size <= length; pos += record_size) {
+            positions.push_back(static_cast<int>(pos));
+        }
+    }
+    std::sort(positions.begin(), positions.end());
+
+    std::map<int, int> moved;
+    for (size_t begin = 0; begin < positions.size(); begin += SHOW_BATCH) {
+        std::vector<int> batch(positions.begin() + begin,
+                               positions.begin() + std::min(positions.size(), begin + SHOW_BATCH));
+        std::vector<long long> offsets(batch.begin(), batch.end());
+        std::vector<Book> books;
+        legacy_books.read_many(offsets, books);
+        for (size_t i = 0; i < books.size(); i++) {
+            if (books[i].ISBN[0] == '\0') {
+                continue;  // 已删除的空槽位
+            }
+            int to = write_book(books[i]);
+            if (relocating) {
+                relocate_keyed(books[i], batch[i], to);
+                moved[batch[i]] = to;
+            }
+        }
+    }
+    relocate_all(nameIndex, moved);
+    relocate_all(authorIndex, moved);
+    Journal::shared().commit();
+    std::remove(LEGACY_BOOK_DATA);
+}
+
 // 检查ISBN
 bool BookSystem::ISBN_check(const std::string& s) {
     if (s.empty() || s.length() > 20) return false;  // 最大长度20
@@ -40,27 +303,167 @@ bool BookSystem::other_check(const std::string& s) {
     return true;
 }
 
-// 分割关键词字符串
-static std::vector<std::string> split_keywords(const std::string& keyword_str) {
-    std::vector<std::string> keywords;
-    std::string current;
-
-    for (char c : keyword_str) {
-        if (c == '|') {
-            if (!current.empty()) {
-                keywords.push_back(current);
-                current.clear();
+// 检查价格：非空，不超过13个字符，只含数字和至多一个小数点，且至少有一位数字
+bool BookSystem::price_check(const std::string& s) {
+    if (s.empty() || s.length() > 13) return false;
+    bool dot_found = false, digit_found = false;
+    for (char c : s) {
+        if (c == '.') {
+            if (dot_found) {
+                return false;
             }
+            dot_found = true;
+        }
+        else if (isdigit(c)) {
+            digit_found = true;
         }
         else {
-            current += c;
+            return false;
         }
     }
+    return digit_found;
+}
 
-    if (!current.empty()) {
-        keywords.push_back(current);
+template<int INDEX_LEN>
+std::vector<BookSystem::BookIndex> BookSystem::scan_prefix(IndexEngine<INDEX_LEN, BookIndex>& index,
+                                                         const std::string& prefix) {
+    std::vector<BookIndex> results;
+    for (auto cursor = index.prefix(prefix.c_str()); cursor.valid(); cursor.next()) {
+        results.push_back(cursor.value());
     }
-    return keywords;
+    return results;
+}
+
+// 以作者名为键的旧索引存在而新索引为空时逐条换成字典编号的键，原有条目（包括改ISBN后留下的）照旧保留
+// 在migrate_book_data之前进行，条目中的位置随图书数据一起改写；旧文件由migrate_string_indexes删除
+void BookSystem::migrate_author_index() {
+    // ISBN索引为空时全部索引将由rebuild_indexes重建
+    if (authorIndex.lower_bound("").valid() || !ISBNIndex.lower_bound("").valid()
+        || !std::ifstream(LEGACY_AUTHOR_INDEX).good()) {
+        return;
+    }
+    IndexEngine<61, BookIndex> legacy(LEGACY_AUTHOR_INDEX);
+    std::vector<std::pair<std::string, BookIndex>> entries;
+    for (auto cursor = legacy.lower_bound(""); cursor.valid(); cursor.next()) {
+        entries.emplace_back(string_key(cursor.index(), true), cursor.value());
+    }
+    authorIndex.bulk_load(entries.begin(), entries.end());
+}
+
+// 作者、关键词索引改为以字典编号为键：旧索引文件（以字符串为键的作者、关键词索引）存在时
+// 补建为空的关键词索引（条目总与图书一致，由ISBN索引和图书数据重建），提交后删除旧文件
+void BookSystem::migrate_string_indexes() {
+    std::vector<std::string> legacy_files = {LEGACY_KEYWORD_INDEX, LEGACY_AUTHOR_INDEX};
+    bool found = false;
+    for (const auto& file : legacy_files) {
+        found = found || std::ifstream(file).good();
+    }
+    if (!found) {
+        return;
+    }
+
+    // 索引刚由rebuild_indexes重建时新索引已经完整
+    if (keywordIndex.size() == 0) {
+        std::vector<int> positions;
+        for (auto cursor = ISBNIndex.lower_bound(""); cursor.valid(); cursor.next()) {
+            positions.push_back(cursor.value().storage_pos);
+        }
+        std::vector<Book> books;
+        read_books(positions, books);
+        std::vector<std::pair<std::string, int>> entries;
+        for (size_t i = 0; i < books.size(); i++) {
+            for (const auto& keyword : split_keywords(books[i].Keyword)) {
+                entries.emplace_back(string_key(keyword, true), positions[i]);
+            }
+        }
+        keywordIndex.bulk_load(entries.begin(), entries.end());
+    }
+    Journal::shared().commit();
+    for (const auto& file : legacy_files) {
+        std::remove(file.c_str());
+        std::remove((file + ".bloom").c_str());
+    }
+}
+
+void BookSystem::rebuild_indexes() {
+    typedef std::vector<std::pair<std::string, BookIndex>> Entries;
+    Entries isbn_entries, name_entries, author_entries, price_entries;
+    std::vector<std::pair<std::string, int>> keyword_entries;
+
+    // 顺序扫描图书数据，收集各索引的条目
+    for (int id = 1; id <= bookStorage.size(); id++) {
+        Book book;
+        read_book(book, id);
+        if (book.ISBN[0] == '\0') {
+            continue;
+        }
+        BookIndex idx;
+        std::memset(&idx, 0, sizeof(idx));
+        std::strcpy(idx.ISBN, book.ISBN);
+        idx.storage_pos = id;
+
+        isbn_entries.emplace_back(book.ISBN, idx);
+        price_entries.emplace_back(price_key(book.Price, book.ISBN), idx);
+        if (book.BookName[0] != '\0') {
+            name_entries.emplace_back(book.BookName, idx);
+        }
+        if (book.Author[0] != '\0') {
+            author_entries.emplace_back(string_key(book.Author, true), idx);
+        }
+        for (const auto& keyword : split_keywords(book.Keyword)) {
+            keyword_entries.emplace_back(string_key(keyword, true), idx.storage_pos);
+        }
+    }
+
+    // 排序后整块写入
+    ISBNIndex.bulk_load(isbn_entries.begin(), isbn_entries.end());
+    ISBNHash.bulk_load(isbn_entries.begin(), isbn_entries.end());
+    nameIndex.bulk_load(name_entries.begin(), name_entries.end());
+    authorIndex.bulk_load(author_entries.begin(), author_entries.end());
+    keywordIndex.bulk_load(keyword_entries.begin(), keyword_entries.end());
+    priceIndex.bulk_load(price_entries.begin(), price_entries.end());
+}
+
+// 扫描整个索引，按moved（原位置 -> 新编号）改写条目的位置，包括修改图书时未能删除的旧条目
+template<int INDEX_LEN>
+void BookSystem::relocate_all(IndexEngine<INDEX_LEN, BookIndex>& index, const std::map<int, int>& moved) {
+    std::vector<std::pair<std::string, BookIndex>> entries;
+    for (auto cursor = index.lower_bound(""); cursor.valid(); cursor.next()) {
+        if (moved.count(cursor.value().storage_pos)) {
+            entries.emplace_back(cursor.index(), cursor.value());
+        }
+    }
+    for (const auto& entry : entries) {
+        BookIndex idx = entry.second;
+        idx.storage_pos = moved.at(idx.storage_pos);
+        index.remove(entry.first.c_str(), entry.second);
+        index.insert(entry.first.c_str(), idx);
+    }
+}
+
+// ISBN、价格索引中的条目总与图书当前的ISBN和价格一致，按图书内容即可找到
+void BookSystem::relocate_keyed(const Book& book, int from, int to) {
+    BookIndex old_idx, new_idx;
+    std::memset(&old_idx, 0, sizeof(old_idx));
+    std::strcpy(old_idx.ISBN, book.ISBN);
+    old_idx.storage_pos = from;
+    new_idx = old_idx;
+    new_idx.storage_pos = to;
+
+    ISBNIndex.remove(book.ISBN, old_idx);
+    ISBNIndex.insert(book.ISBN, new_idx);
+    ISBNHash.remove(book.ISBN, old_idx);
+    ISBNHash.insert(book.ISBN, new_idx);
+    priceIndex.remove(price_key(book.Price, book.ISBN).c_str(), old_idx);
+    priceIndex.insert(price_key(book.Price, book.ISBN).c_str(), new_idx);
+}
+
+void BookSystem::vacuum() {
+    // 索引：把不满的块填满并按顺序重新排列
+    ISBNIndex.vacuum(VACUUM_BLOCKS);
+    nameIndex.vacuum(VACUUM_BLOCKS);
+    authorIndex.vacuum(VACUUM_BLOCKS);
+    priceIndex.vacuum(VACUUM_BLOCKS);
 }
 
 // 检查关键词是否重复
@@ -83,26 +486,32 @@ void BookSystem::show() {
         return;
     }
 
-    // 获取所有图书
-    auto all_books = ISBNIndex.get_all();
-
-    if (all_books.empty()) {
+    // 沿ISBN索引流式输出，每攒够一批位置就批量读出图书并输出
+    auto cursor = ISBNIndex.lower_bound("");
+    if (!cursor.valid()) {
         std::cout << "\n";  // 输出空行
         return;
     }
 
-    // 输出所有图书
-    for (const auto& book_idx : all_books) {
-        Book book;
-        bookStorage.read(book, book_idx.storage_pos);
+    std::vector<int> positions;
+    std::vector<Book> books;
+    positions.reserve(SHOW_BATCH);
+    while (cursor.valid()) {
+        positions.clear();
+        for (; cursor.valid() && (int)positions.size() < SHOW_BATCH; cursor.next()) {
+            positions.push_back(cursor.value().storage_pos);
+        }
+        read_books(positions, books);
 
         // 输出格式：ISBN\tBookName\tAuthor\tKeyword\tPrice\tStock
-        std::cout << book.ISBN << "\t"
-                  << book.BookName << "\t"
-                  << book.Author << "\t"
-                  << book.Keyword << "\t"
-                  << std::fixed << std::setprecision(2) << book.Price << "\t"
-                  << book.Stock << "\n";
+        for (const Book& book : books) {
+            std::cout << book.ISBN << "\t"
+                      << book.BookName << "\t"
+                      << book.Author << "\t"
+                      << book.Keyword << "\t"
+                      << std::fixed << std::setprecision(2) << book.Price << "\t"
+                      << book.Stock << "\n";
+        }
     }
 }
 
@@ -124,14 +533,14 @@ void BookSystem::show(const string& some, const string& value) {
         // 查找图书
         BookIndex target;
         strcpy(target.ISBN, value.c_str());
-        auto result = ISBNIndex.find(value.c_str());
+        auto result = ISBNHash.find(value.c_str());
         if (result.empty()) {
             std::cout << "\n";  // 输出空行
             return;
         }
         // 输出图书信息
         Book book;
-        bookStorage.read(book, result[0].storage_pos);
+        read_book(book, result[0].storage_pos);
         std::cout << book.ISBN << "\t"
               << book.BookName << "\t"
               << book.Author << "\t"
@@ -140,26 +549,82 @@ void BookSystem::show(const string& some, const string& value) {
               << book.Stock << "\n";
         return;
     }
+    else if (some == "price") {
+        // 参数形如LO..HI
+        size_t sep = value.find("..");
+        if (sep == std::string::npos || !price_check(value.substr(0, sep)) || !price_check(value.substr(sep + 2))) {
+            std::cout << "Invalid\n";
+            return;
+        }
+        double low = stod(value.substr(0, sep));
+        double high = stod(value.substr(sep + 2));
+
+        // 沿价格索引扫描键区间，每攒够一批位置就批量读出图书并输出
+        bool found = false;
+        if (low <= high) {
+            // ISBN只含32 ~ 126的字符，上界后接127即不小于价格为high的所有键
+            auto cursor = priceIndex.range(price_key(low, "").c_str(), price_key(high, "\x7f").c_str());
+            std::vector<int> positions;
+            std::vector<Book> books;
+            positions.reserve(SHOW_BATCH);
+            while (cursor.valid()) {
+                positions.clear();
+                for (; cursor.valid() && (int)positions.size() < SHOW_BATCH; cursor.next()) {
+                    positions.push_back(cursor.value().storage_pos);
+                }
+                read_books(positions, books);
+                found = true;
+                for (const Book& book : books) {
+                    std::cout << book.ISBN << "\t"
+                              << book.BookName << "\t"
+                              << book.Author << "\t"
+                              << book.Keyword << "\t"
+                              << std::fixed << std::setprecision(2) << book.Price << "\t"
+                              << book.Stock << "\n";
+                }
+            }
+        }
+        if (!found) {
+            std::cout << "\n";  // 输出空行
+        }
+    }
     else {
         std::vector<BookIndex> results;
+        std::vector<int> positions;  // 关键词索引直接给出图书位置
         // name
-        if (some == "name") {
+        if (some == "name" || some == "name-prefix") {
             if (!other_check(value)) {
                 std::cout << "Invalid\n";
                 return;
             }
 
-            results = nameIndex.find(value.c_str());
+            if (some == "name-prefix") {
+                results = scan_prefix(nameIndex, value);
+            }
+            else {
+                results = nameIndex.find(value.c_str());
+            }
         }
 
         // author
-        else if (some == "author") {
+        else if (some == "author" || some == "author-prefix") {
             if (!other_check(value)) {
                 std::cout << "Invalid\n";
                 return;
             }
 
-            results = authorIndex.find(value.c_str());
+            // 字典中取出符合条件的作者编号，再按编号查作者索引
+            std::vector<int> ids;
+            if (some == "author-prefix") {
+                ids = dictionary.prefix(value);
+            }
+            else if (int id = dictionary.find(value)) {
+                ids.push_back(id);
+            }
+            for (int id : ids) {
+                std::vector<BookIndex> found = authorIndex.find(StringDictionary::id_key(id).c_str());
+                results.insert(results.end(), found.begin(), found.end());
+            }
         }
 
         // keyword
@@ -176,7 +641,9 @@ void BookSystem::show(const string& some, const string& value) {
                 return;
             }
 
-            results = keywordIndex.find(keywords[0].c_str());
+            if (int id = dictionary.find(keywords[0])) {
+                positions = keywordIndex.find(StringDictionary::id_key(id).c_str());
+            }
         }
 
         else {
@@ -184,17 +651,28 @@ void BookSystem::show(const string& some, const string& value) {
             return;  // some不合法
         }
 
-        if (results.empty()) {
+        std::vector<Book> books;
+        if (positions.empty()) {
+            // 按ISBN排序后批量读出
+            std::sort(results.begin(), results.end());
+            positions.reserve(results.size());
+            for (const auto& book_idx : results) {
+                positions.push_back(book_idx.storage_pos);
+            }
+            read_books(positions, books);
+        }
+        else {
+            // 按位置顺序读出后再按ISBN排序
+            read_books(positions, books);
+            std::sort(books.begin(), books.end(), [](const Book& a, const Book& b) {
+                return std::strcmp(a.ISBN, b.ISBN) < 0;
+            });
+        }
+        if (books.empty()) {
             std::cout << "\n";  // 输出空行
             return;
         }
-        // 按ISBN排序
-        std::sort(results.begin(), results.end());
-        // 输出图书信息
-        for (const auto& book_idx : results) {
-            Book book;
-            bookStorage.read(book, book_idx.storage_pos);
-
+        for (const Book& book : books) {
             std::cout << book.ISBN << "\t"
                       << book.BookName << "\t"
                       << book.Author << "\t"
@@ -220,27 +698,28 @@ void BookSystem::buy(const string& ISBN, int Quantity) {
     }
 
     // 查找图书
-    auto result = ISBNIndex.find(ISBN.c_str());
+    auto result = ISBNHash.find(ISBN.c_str());
     if (result.empty()) {
         std::cout << "Invalid\n";
         return;
     }
-    // 检查库存
-    Book book;
-    bookStorage.read(book, result[0].storage_pos);
-    if (book.Stock < Quantity) {
+    // 检查库存：只读写图书的数值记录
+    BookStock stock;
+    long long pos = stock_pos(result[0].storage_pos);
+    stockStorage.read(stock, pos);
+    if (stock.Stock < Quantity) {
         std::cout << "Invalid\n";
         return;
     }
 
     // 计算总价
-    double total_price = book.Price * Quantity;
+    double total_price = stock.Price * Quantity;
     // 减少库存
-    book.Stock -= Quantity;
-    book.TotalCost += total_price; // 每本书的交易总额
+    stock.Stock -= Quantity;
+    stock.TotalCost += total_price; // 每本书的交易总额
 
     // 更新图书信息
-    bookStorage.update(book, result[0].storage_pos);
+    stockStorage.update(stock, pos);
 
     // 输出总金额
     std::cout << std::fixed << std::setprecision(2) << total_price << "\n";
@@ -260,7 +739,7 @@ void BookSystem::select(const string& ISBN) {
         return;
     }
     // 查找图书
-    auto result = ISBNIndex.find(ISBN.c_str());
+    auto result = ISBNHash.find(ISBN.c_str());
     if (result.empty()) {
         // 图书不存在，创建新图书
         Book new_book;
@@ -271,12 +750,14 @@ void BookSystem::select(const string& ISBN) {
         new_book.Stock = 0;
         new_book.Price = 0;
         new_book.TotalCost = 0;
-        int pos = bookStorage.write(new_book);
+        int pos = write_book(new_book);
         // 创建索引
         BookIndex idx;
         strcpy(idx.ISBN, ISBN.c_str());
         idx.storage_pos = pos;
         ISBNIndex.insert(ISBN.c_str(), idx);
+        ISBNHash.insert(ISBN.c_str(), idx);
+        priceIndex.insert(price_key(new_book.Price, new_book.ISBN).c_str(), idx);
     }
     // 设置选中状态
     selected = true;
@@ -301,7 +782,7 @@ void BookSystem::modify(const std::string& line) {
     }
 
     // 从书库里找到选中的书
-    auto result = ISBNIndex.find(selected_ISBN);
+    auto result = ISBNHash.find(selected_ISBN);
     if (result.empty()) {
         std::cout << "Invalid\n";
         return;
@@ -309,11 +790,11 @@ void BookSystem::modify(const std::string& line) {
 
     Book book;
     int pos = result[0].storage_pos;
-    bookStorage.read(book, pos);
+    read_book(book, pos);
 
     std::string new_ISBN, new_name, new_author, new_keywords;
     bool have_ISBN = false, have_name = false, have_author = false, have_keyword = false;
-    double new_price = book.Price;
+    double old_price = book.Price;  // 价格索引中的旧条目按原价格删除
 
     size_t start = 0;
     while (start < line.length()) {
@@ -361,26 +842,7 @@ void BookSystem::modify(const std::string& line) {
         }
         else if (p.substr(0, 7) == "-price=") {
             std::string price_str = p.substr(7);
-            if (price_str.length() > 13) {
-                cout << "Invalid\n";
-                return;  // 长度不能超过13
-            }
-            bool valid = true;
-            bool dot_found = false;
-            for (char c : price_str) {
-                if (c == '.') {
-                    if (dot_found) {
-                        valid = false;
-                        break;
-                    }
-                    dot_found = true;
-                }
-                else if (!isdigit(c)) {
-                    valid = false;
-                    break;
-                }
-            }
-            if (!valid || price_str.empty()) {
+            if (!price_check(price_str)) {
                 cout << "Invalid\n";
                 return;
             }
@@ -403,7 +865,7 @@ void BookSystem::modify(const std::string& line) {
         }
         // 检查新ISBN是否和其他书重复
         if (strcmp(book.ISBN, new_ISBN.c_str()) != 0) {
-            auto exist = ISBNIndex.find(new_ISBN.c_str());
+            auto exist = ISBNHash.find(new_ISBN.c_str());
             if (!exist.empty()) {
                 std::cout << "Invalid\n";  // ISBN已存在
                 return;
@@ -453,11 +915,13 @@ void BookSystem::modify(const std::string& line) {
     if (have_ISBN) {
         // 从索引中删除旧的ISBN
         ISBNIndex.remove(book.ISBN, result[0]);
+        ISBNHash.remove(book.ISBN, result[0]);
         // 添加新的ISBN到索引
         BookIndex new_idx;
         strcpy(new_idx.ISBN, new_ISBN.c_str());
         new_idx.storage_pos = pos;
         ISBNIndex.insert(new_ISBN.c_str(), new_idx);
+        ISBNHash.insert(new_ISBN.c_str(), new_idx);
         // 更新书里的ISBN
         strcpy(book.ISBN, new_ISBN.c_str());
         strcpy(selected_ISBN, new_ISBN.c_str());  // 更新选中的ISBN
@@ -480,13 +944,13 @@ void BookSystem::modify(const std::string& line) {
     if (have_author) {
         // 删除旧的作者索引
         if (book.Author[0] != '\0') {
-            authorIndex.remove(book.Author, result[0]);
+            authorIndex.remove(string_key(book.Author, false).c_str(), result[0]);
         }
         // 添加新的作者索引
         BookIndex author_idx;
         strcpy(author_idx.ISBN, book.ISBN);
         author_idx.storage_pos = pos;
-        authorIndex.insert(new_author.c_str(), author_idx);
+        authorIndex.insert(string_key(new_author, true).c_str(), author_idx);
         // 更新书里的作者
         strcpy(book.Author, new_author.c_str());
     }
@@ -496,23 +960,30 @@ void BookSystem::modify(const std::string& line) {
         if (book.Keyword[0] != '\0') {
             std::vector<std::string> old_keywords = split_keywords(book.Keyword);
             for (const auto& keyword : old_keywords) {
-                keywordIndex.remove(keyword.c_str(), result[0]);
+                keywordIndex.remove(string_key(keyword, false).c_str(), pos);
             }
         }
         // 添加新的关键词索引
         std::vector<std::string> keywords = split_keywords(new_keywords);
         for (const auto& keyword : keywords) {
-            BookIndex keyword_idx;
-            strcpy(keyword_idx.ISBN, book.ISBN);
-            keyword_idx.storage_pos = pos;
-            keywordIndex.insert(keyword.c_str(), keyword_idx);
+            keywordIndex.insert(string_key(keyword, true).c_str(), pos);
         }
         // 更新书里的关键词
         strcpy(book.Keyword, new_keywords.c_str());
     }
 
+    // 改价格或ISBN时更新价格索引
+    if (book.Price != old_price || have_ISBN) {
+        BookIndex price_idx;
+        std::memset(&price_idx, 0, sizeof(price_idx));
+        strcpy(price_idx.ISBN, book.ISBN);
+        price_idx.storage_pos = pos;
+        priceIndex.remove(price_key(old_price, result[0].ISBN).c_str(), result[0]);
+        priceIndex.insert(price_key(book.Price, book.ISBN).c_str(), price_idx);
+    }
+
     // 修改存储中的图书信息
-    bookStorage.update(book, pos);
+    update_book(book, pos);
 }
 
 // 以指定交易总额购入指定数量的选中图书，增加其库存数
@@ -533,18 +1004,19 @@ void BookSystem::import(int Quantity, double TotalCost) {
         return;
     }
     // 获取选中图书
-    auto result = ISBNIndex.find(selected_ISBN);
+    auto result = ISBNHash.find(selected_ISBN);
     if (result.empty()) {
         std::cout << "Invalid\n";
         return;
     }
-    Book book;
-    int pos = result[0].storage_pos;
-    bookStorage.read(book, pos);
+    // 只读写图书的数值记录
+    BookStock stock;
+    long long pos = stock_pos(result[0].storage_pos);
+    stockStorage.read(stock, pos);
     // 增加库存
-    book.Stock += Quantity;
+    stock.Stock += Quantity;
 
     // 更新图书信息
-    bookStorage.update(book, pos);
+    stockStorage.update(stock, pos);
     logSystem->recordFinance(-TotalCost);
 }
\ No newline at end of file
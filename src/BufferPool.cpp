@@ -0,0 +1,276 @@
+#include "BufferPool.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static const int DIFF_GAP = 32;  // 相隔不足该字节数的变化区间合并记入日志，省去条目头的开销
+
+// 逐8字节比较before与after，对每个变化的区间调用emit(起点, 长度)
+template<typename Emit>
+static void diff_ranges(const char* before, const char* after, int size, Emit emit) {
+    int start = -1, last = 0;
+    for (int pos = 0; pos < size; pos += 8) {
+        int length = std::min(8, size - pos);
+        bool same;
+        if (length == 8) {
+            uint64_t a, b;
+            std::memcpy(&a, before + pos, 8);
+            std::memcpy(&b, after + pos, 8);
+            same = a == b;
+        }
+        else {
+            same = std::memcmp(before + pos, after + pos, length) == 0;
+        }
+        if (same) {
+            continue;
+        }
+        if (start != -1 && pos - last >= DIFF_GAP) {
+            emit(start, last - start);
+            start = -1;
+        }
+        if (start == -1) {
+            start = pos;
+        }
+        last = pos + length;
+    }
+    if (start != -1) {
+        emit(start, last - start);
+    }
+}
+
+BufferPool::BufferPool(size_t capacity) : capacity(capacity), used(0) {}
+
+BufferPool& BufferPool::shared() {
+    static BufferPool pool;
+    return pool;
+}
+
+void BufferPool::set_capacity(size_t bytes) {
+    std::lock_guard<std::mutex> guard(latch);
+    capacity = bytes;
+    evict(0);
+}
+
+void BufferPool::write_back(Frame& frame) {
+    if (frame.dirty) {
+        frame.owner->write_page(frame.offset, frame.data.get(), frame.size);
+        frame.dirty = false;
+    }
+    drop_base(frame);  // 写回后磁盘上的内容就是基准
+}
+
+void BufferPool::drop_base(Frame& frame) {
+    if (frame.base) {
+        frame.base.reset();
+        used -= frame.size;
+    }
+}
+
+void BufferPool::evict(size_t need) {
+    auto it = frames.end();
+    while (used + need > capacity && it != frames.begin()) {
+        --it;
+        if (it->pin_count > 0 || ((it->unlogged || it->logging) && it->owner->journaled())) {
+            continue;  // 固定的页面和日志记录尚未落盘的页面不可淘汰
+        }
+        write_back(*it);
+        used -= it->size;
+        table.erase(FrameKey{it->owner, it->offset});
+        it = frames.erase(it);
+    }
+    // 没有可淘汰的页面时允许暂时超出容量
+}
+
+void BufferPool::attach(PageOwner* owner) {
+    std::lock_guard<std::mutex> guard(latch);
+    if (std::find(owners.begin(), owners.end(), owner) == owners.end()) {
+        owners.push_back(owner);
+    }
+}
+
+void BufferPool::forget(Frame* frame) {
+    unlogged_frames.erase(std::remove(unlogged_frames.begin(), unlogged_frames.end(), frame), unlogged_frames.end());
+    logging_frames.erase(std::remove(logging_frames.begin(), logging_frames.end(), frame), logging_frames.end());
+}
+
+void BufferPool::detach(PageOwner* owner) {
+    std::lock_guard<std::mutex> guard(latch);
+    for (auto it = frames.begin(); it != frames.end();) {
+        if (it->owner == owner) {
+            forget(&*it);
+            write_back(*it);
+            used -= it->size;
+            table.erase(FrameKey{it->owner, it->offset});
+            it = frames.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    owner->sync();
+    owners.erase(std::remove(owners.begin(), owners.end(), owner), owners.end());
+}
+
+char* BufferPool::pin(PageOwner* owner, int offset, int size, bool load) {
+    std::unique_lock<std::mutex> guard(latch);
+    auto found = table.find(FrameKey{owner, offset});
+    if (found != table.end()) {
+        // 命中：移到表头；页面正由其他线程读入时等待读入完成（已固定，等待期间不会被淘汰）
+        auto it = found->second;
+        frames.splice(frames.begin(), frames, it);
+        it->pin_count++;
+        loaded.wait(guard, [&it] { return !it->loading; });
+        return it->data.get();
+    }
+
+    evict(size);
+
+    Frame frame;
+    frame.owner = owner;
+    frame.offset = offset;
+    frame.size = size;
+    frame.pin_count = 1;
+    frame.dirty = false;
+    frame.unlogged = false;
+    frame.logging = false;
+    frame.loading = load;
+    frame.fresh = !load;
+    frame.data.reset(new char[size]);
+    std::memset(frame.data.get(), 0, size);
+
+    // 先占住页框再读入：读入在锁外进行，不阻塞其他页面的访问
+    frames.push_front(std::move(frame));
+    auto it = frames.begin();
+    table[FrameKey{owner, offset}] = it;
+    used += size;
+    if (load) {
+        guard.unlock();
+        owner->read_page(offset, it->data.get(), size);
+        guard.lock();
+        it->loading = false;
+        loaded.notify_all();
+    }
+    return it->data.get();
+}
+
+void BufferPool::unpin(PageOwner* owner, int offset, bool dirty) {
+    std::lock_guard<std::mutex> guard(latch);
+    auto found = table.find(FrameKey{owner, offset});
+    if (found == table.end()) {
+        return;
+    }
+    Frame& frame = *found->second;
+    if (frame.pin_count > 0) {
+        frame.pin_count--;
+    }
+    if (dirty) {
+        if (!frame.unlogged && owner->journaled()) {
+            unlogged_frames.push_back(&frame);
+        }
+        frame.dirty = true;
+        frame.unlogged = true;
+    }
+    if (frame.pin_count == 0 && used > capacity) {
+        evict(0);
+    }
+}
+
+void BufferPool::discard(PageOwner* owner, int offset) {
+    std::lock_guard<std::mutex> guard(latch);
+    auto found = table.find(FrameKey{owner, offset});
+    if (found == table.end()) {
+        return;
+    }
+    forget(&*found->second);
+    drop_base(*found->second);
+    used -= found->second->size;
+    frames.erase(found->second);
+    table.erase(found);
+}
+
+void BufferPool::collect(PageOwner* owner, const std::function<void(int, int, const char*, int)>& log) {
+    std::unique_lock<std::mutex> guard(latch);
+    std::vector<Frame*> changed, unread;
+    auto others = std::partition(unlogged_frames.begin(), unlogged_frames.end(),
+                                 [owner](const Frame* frame) { return frame->owner != owner; });
+    changed.assign(others, unlogged_frames.end());
+    unlogged_frames.erase(others, unlogged_frames.end());
+
+    // 没有副本的页面以磁盘上的内容为基准，在锁外读入（有未记入日志修改的页面不会被淘汰）
+    for (Frame* frame : changed) {
+        if (!frame->fresh && !frame->base) {
+            frame->base.reset(new char[frame->size]);
+            used += frame->size;
+            unread.push_back(frame);
+        }
+    }
+    if (!unread.empty()) {
+        guard.unlock();
+        for (Frame* frame : unread) {
+            owner->read_page(frame->offset, frame->base.get(), frame->size);
+        }
+        guard.lock();
+    }
+
+    for (Frame* changed_frame : changed) {
+        Frame& frame = *changed_frame;
+        const char* data = frame.data.get();
+        if (frame.fresh) {
+            log(frame.offset, 0, data, frame.size);  // 磁盘上的内容不可作基准
+            frame.fresh = false;
+        }
+        else {
+            diff_ranges(frame.base.get(), data, frame.size, [&](int begin, int length) {
+                log(frame.offset, begin, data + begin, length);
+            });
+        }
+        frame.unlogged = false;
+        frame.logging = true;
+        logging_frames.push_back(&frame);
+        // 写回之前，这次记入日志的内容是下次比较的基准
+        if (frame.dirty) {
+            if (!frame.base) {
+                frame.base.reset(new char[frame.size]);
+                used += frame.size;
+            }
+            std::memcpy(frame.base.get(), data, frame.size);
+        }
+        else {
+            drop_base(frame);
+        }
+    }
+}
+
+void BufferPool::logged(PageOwner* owner) {
+    std::lock_guard<std::mutex> guard(latch);
+    auto done = std::partition(logging_frames.begin(), logging_frames.end(),
+                               [owner](const Frame* frame) { return frame->owner != owner; });
+    for (auto it = done; it != logging_frames.end(); ++it) {
+        (*it)->logging = false;
+    }
+    logging_frames.erase(done, logging_frames.end());
+    if (used > capacity) {
+        evict(0);
+    }
+}
+
+void BufferPool::flush(PageOwner* owner) {
+    std::lock_guard<std::mutex> guard(latch);
+    flush_owner(owner);
+}
+
+void BufferPool::flush_owner(PageOwner* owner) {
+    for (auto& frame : frames) {
+        if (frame.owner == owner) {
+            write_back(frame);
+        }
+    }
+    owner->sync();
+}
+
+void BufferPool::checkpoint() {
+    std::lock_guard<std::mutex> guard(latch);
+    for (PageOwner* owner : owners) {
+        flush_owner(owner);
+    }
+}
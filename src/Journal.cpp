@@ -0,0 +1,211 @@
+#include "Journal.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+static const uint32_t JOURNAL_MAGIC = 0x4C4E524A;  // "JRNL"
+
+// CRC32C（Castagnoli多项式）的查表：table[k][b]为字节b后跟k个0字节的余数，用于每次处理8字节
+struct CrcTable {
+    uint32_t table[8][256];
+
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+            }
+            table[0][i] = crc;
+        }
+        for (int i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+// CRC32C校验和（slicing-by-8，按小端序每次读入8字节）
+static uint32_t checksum(const char* data, size_t length) {
+    static const CrcTable crc_table;
+    const uint32_t (*t)[256] = crc_table.table;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (; length >= 8; length -= 8, bytes += 8) {
+        uint32_t low, high;
+        std::memcpy(&low, bytes, 4);
+        std::memcpy(&high, bytes + 4, 4);
+        low ^= crc;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+    }
+    for (; length > 0; length--, bytes++) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *bytes) & 0xFF];
+    }
+    return ~crc;
+}
+
+template<typename T>
+static void append(std::vector<char>& buffer, const T& value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static bool take(const char*& cursor, const char* end, T& value) {
+    if (end - cursor < static_cast<std::ptrdiff_t>(sizeof(T))) return false;
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return true;
+}
+
+Journal::Journal(const std::string& journal_name) : journal_name(journal_name) {}
+
+Journal::~Journal() {
+    journal_file.close();
+}
+
+Journal& Journal::shared() {
+    static Journal journal;
+    return journal;
+}
+
+void Journal::open_journal(bool truncate) {
+    if (!journal_file.is_open()) {
+        journal_file.open(journal_name);
+    }
+    if (truncate) {
+        journal_file.truncate(0);
+        journal_file.sync();
+        journal_size = 0;
+    }
+    else {
+        journal_size = static_cast<size_t>(journal_file.size());
+    }
+}
+
+void Journal::apply(const char* payload, size_t length,
+                    std::map<std::string, std::unique_ptr<PositionalFile>>& files) {
+    std::vector<char> zeros;
+    const char* cursor = payload;
+    const char* end = payload + length;
+
+    while (cursor < end) {
+        uint16_t name_len;
+        long long offset;
+        int32_t size, stored;
+        if (!take(cursor, end, name_len) || end - cursor < name_len) return;
+        std::string name(cursor, name_len);
+        cursor += name_len;
+        if (!take(cursor, end, offset) || !take(cursor, end, size) || !take(cursor, end, stored)) return;
+        if (stored > size || end - cursor < stored) return;
+
+        auto& file = files[name];
+        if (!file) {
+            file.reset(new PositionalFile);  // 文件可能尚未创建
+            file->open(name);
+        }
+        file->write(offset, cursor, stored);
+        if (size > stored) {
+            zeros.assign(size - stored, 0);
+            file->write(offset + stored, zeros.data(), zeros.size());
+        }
+        cursor += stored;
+    }
+}
+
+void Journal::recover() {
+    std::ifstream in(journal_name, std::ios::binary);
+    if (in) {
+        std::map<std::string, std::unique_ptr<PositionalFile>> files;
+        std::vector<char> payload;
+        while (true) {
+            uint32_t magic, length, sum;
+            if (!in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || magic != JOURNAL_MAGIC) break;
+            if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) break;
+            payload.resize(length);
+            if (!in.read(payload.data(), length)) break;
+            if (!in.read(reinterpret_cast<char*>(&sum), sizeof(sum))) break;
+            if (sum != checksum(payload.data(), length)) break;  // 不完整的尾部记录
+            apply(payload.data(), length, files);
+        }
+        in.close();
+        // 重放的内容落盘后才能清空日志
+        for (auto& file : files) {
+            file.second->sync();
+        }
+    }
+    open_journal(true);
+}
+
+void Journal::attach(JournalClient* client) {
+    if (std::find(clients.begin(), clients.end(), client) == clients.end()) {
+        clients.push_back(client);
+    }
+}
+
+void Journal::detach(JournalClient* client) {
+    clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+    if (clients.empty()) {
+        // 所有文件都已写回原位，日志不再需要
+        pending.clear();
+        open_journal(true);
+        journal_file.close();
+    }
+}
+
+void Journal::record(const std::string& file, long long offset, const char* data, int size) {
+    // 末尾的0字节不保存，重放时补齐
+    int stored = size;
+    while (stored > 0 && data[stored - 1] == 0) {
+        stored--;
+    }
+
+    append(pending, static_cast<uint16_t>(file.size()));
+    pending.insert(pending.end(), file.begin(), file.end());
+    append(pending, offset);
+    append(pending, static_cast<int32_t>(size));
+    append(pending, static_cast<int32_t>(stored));
+    pending.insert(pending.end(), data, data + stored);
+}
+
+void Journal::commit() {
+    for (JournalClient* client : clients) {
+        client->prepare_commit();
+    }
+    if (pending.empty()) {
+        return;
+    }
+
+    if (!journal_file.is_open()) {
+        open_journal(false);
+    }
+    uint32_t length = static_cast<uint32_t>(pending.size());
+    uint32_t sum = checksum(pending.data(), pending.size());
+    std::vector<char> entry;
+    entry.reserve(sizeof(JOURNAL_MAGIC) + sizeof(length) + pending.size() + sizeof(sum));
+    append(entry, JOURNAL_MAGIC);
+    append(entry, length);
+    entry.insert(entry.end(), pending.begin(), pending.end());
+    append(entry, sum);
+    journal_file.write(static_cast<long long>(journal_size), entry.data(), entry.size());
+    journal_file.sync();  // 每条指令只落盘这一次
+    journal_size += entry.size();
+    pending.clear();
+    for (JournalClient* client : clients) {
+        client->committed();
+    }
+
+    if (journal_size > JOURNAL_CHECKPOINT_SIZE) {
+        checkpoint();
+    }
+}
+
+void Journal::checkpoint() {
+    // 各文件的checkpoint在返回前已把写回的内容刷到磁盘，此后才能清空日志
+    for (JournalClient* client : clients) {
+        client->checkpoint();
+    }
+    open_journal(true);
+}
@@ -45,12 +45,18 @@ void LogSystem::recordFinance(double amount) {
     } else {
         total_expense += (-amount);
     }
+
+    // 统计数据随本条指令一同提交
+    financeStorage.write_info(finance_count, 1);
+    financeStorage.write_info(total_income, 2);
+    financeStorage.write_info(total_expense, 3);
 }
 
 // 记录操作
 void LogSystem::recordOperation(const std::string& UserID, const std::string& operation) {
     OperationLog log(UserID, operation, ++operation_count);
     operationStorage.write(log);
+    operationStorage.write_info(operation_count, 1);
 }
 
 // 记录交易（购买或进货）
@@ -104,16 +110,20 @@ void LogSystem::showFinance(int count) {
     double recent_income = 0.0;
     double recent_expense = 0.0;
 
-    // 从后往前读取最近的count笔交易
+    // 最近的count笔交易一次批量读出（第i笔在文件头的3个double之后）
+    std::vector<long long> positions;
+    positions.reserve(count);
     for (long long i = finance_count; i > finance_count - count; i--) {
-        FinanceLog log;
-        financeStorage.read(log, (i-1) * sizeof(FinanceLog));
+        positions.push_back(static_cast<long long>(3 * sizeof(double) + (i-1) * sizeof(FinanceLog)));
+    }
+    std::vector<FinanceLog> logs;
+    financeStorage.read_many(positions, logs);
+    for (const FinanceLog& log : logs) {
         if (log.amount > 0) {
             recent_income += log.amount;
         } else {
             recent_expense += (-log.amount);
         }
-
     }
 
     std::cout << std::fixed << std::setprecision(2)
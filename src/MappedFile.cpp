@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length > 0) {
+        void* addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base = static_cast<char*>(addr);
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (base != nullptr) {
+        msync(base, length, MS_SYNC);
+        munmap(base, length);
+        base = nullptr;
+    }
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+    length = 0;
+}
+
+void MappedFile::resize(size_t new_size) {
+    if (fd == -1 || new_size == length) {
+        return;
+    }
+    if (ftruncate(fd, static_cast<off_t>(new_size)) == -1) {
+        return;
+    }
+
+    void* addr;
+    if (base == nullptr) {
+        addr = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    else {
+#ifdef __linux__
+        addr = mremap(base, length, new_size, MREMAP_MAYMOVE);
+#else
+        munmap(base, length);
+        addr = mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#endif
+    }
+    if (addr == MAP_FAILED) {
+        base = nullptr;
+        length = 0;
+        return;
+    }
+    base = static_cast<char*>(addr);
+    length = new_size;
+}
+
+void MappedFile::reserve(size_t need) {
+    if (need <= length) {
+        return;
+    }
+    size_t new_size = length > 0 ? length : need;
+    while (new_size < need) {
+        new_size *= 2;
+    }
+    resize(new_size);
+}
+
+void MappedFile::sync() {
+    if (base != nullptr) {
+        msync(base, length, MS_SYNC);
+    }
+}
@@ -0,0 +1,74 @@
+#include "PositionalFile.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+PositionalFile::~PositionalFile() {
+    close();
+}
+
+bool PositionalFile::open(const std::string& path) {
+    close();
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    return fd != -1;
+}
+
+void PositionalFile::close() {
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+long long PositionalFile::size() const {
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        return 0;
+    }
+    return static_cast<long long>(st.st_size);
+}
+
+void PositionalFile::read(long long offset, char* data, size_t size) const {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    if (done < size) {
+        std::memset(data + done, 0, size - done);  // 新分配的块可能还未写到文件中
+    }
+}
+
+void PositionalFile::write(long long offset, const char* data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = pwrite(fd, data + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+void PositionalFile::truncate(long long size) {
+    if (fd != -1 && size < this->size()) {
+        ftruncate(fd, static_cast<off_t>(size));
+    }
+}
+
+void PositionalFile::sync() {
+    if (fd != -1) {
+        fdatasync(fd);
+    }
+}
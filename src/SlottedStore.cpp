@@ -0,0 +1,229 @@
+#include "SlottedStore.h"
+#include <algorithm>
+#include <cstring>
+
+static const int SLOT_CACHE_RECORDS = 4096;  // 对照表记录缓存的容量
+static const int PAGE_HEADER_BYTES = 4;      // sizeof(PageHeader)
+static const int SLOT_BYTES = 4;             // sizeof(Slot)
+
+SlottedStore::SlottedStore(const std::string& page_name, const std::string& slot_name) : filename(page_name) {
+    static_assert(sizeof(PageHeader) == PAGE_HEADER_BYTES && sizeof(Slot) == SLOT_BYTES, "slotted page layout");
+    slots.initialise(slot_name);
+    slots.set_cache_capacity(SLOT_CACHE_RECORDS);
+    data_file.open(filename);
+    bool is_new = data_file.size() < static_cast<long long>(sizeof(StoreHeader));
+    pool->attach(this);
+    journal->attach(this);
+    if (is_new) {
+        store_header.page_count = 1;
+        store_header.record_count = 0;
+        store_header.last_page = 0;
+        write_store_header();
+    }
+    else {
+        const char* page = pin_page(0);
+        std::memcpy(&store_header, page, sizeof(StoreHeader));
+        unpin_page(0, false);
+    }
+}
+
+SlottedStore::~SlottedStore() {
+    // 写回缓冲池中属于本文件的脏页
+    pool->detach(this);
+    journal->detach(this);
+    data_file.close();
+}
+
+char* SlottedStore::pin_page(int page, bool load) {
+    return pool->pin(this, page, SLOTTED_PAGE_SIZE, load);
+}
+
+void SlottedStore::unpin_page(int page, bool dirty) {
+    pool->unpin(this, page, dirty);
+}
+
+void SlottedStore::write_store_header() {
+    char* page = pin_page(0);
+    std::memcpy(page, &store_header, sizeof(StoreHeader));
+    unpin_page(0, true);
+}
+
+long long SlottedStore::slot_pos(int id) {
+    return 2 * sizeof(double) + (id - 1) * static_cast<long long>(sizeof(RecordSlot));
+}
+
+int SlottedStore::max_record() {
+    return SLOTTED_PAGE_SIZE - PAGE_HEADER_BYTES - SLOT_BYTES;
+}
+
+int SlottedStore::free_bytes(const char* page, int except) {
+    const PageHeader* header = reinterpret_cast<const PageHeader*>(page);
+    const Slot* slot = reinterpret_cast<const Slot*>(page + PAGE_HEADER_BYTES);
+    int used = PAGE_HEADER_BYTES + header->slot_count * SLOT_BYTES;
+    for (int i = 0; i < header->slot_count; i++) {
+        if (slot[i].offset != 0 && i != except) {
+            used += slot[i].length;
+        }
+    }
+    return SLOTTED_PAGE_SIZE - used;
+}
+
+void SlottedStore::compact_page(char* page, int except) {
+    PageHeader* header = reinterpret_cast<PageHeader*>(page);
+    Slot* slot = reinterpret_cast<Slot*>(page + PAGE_HEADER_BYTES);
+    std::vector<char> image(page, page + SLOTTED_PAGE_SIZE);
+    int end = SLOTTED_PAGE_SIZE;
+    for (int i = 0; i < header->slot_count; i++) {
+        if (slot[i].offset == 0) {
+            continue;
+        }
+        if (i == except) {
+            slot[i].offset = 0;
+            slot[i].length = 0;
+            continue;
+        }
+        end -= slot[i].length;
+        std::memcpy(page + end, image.data() + slot[i].offset, slot[i].length);
+        slot[i].offset = static_cast<uint16_t>(end);
+    }
+    header->data_start = static_cast<uint16_t>(end);
+}
+
+int SlottedStore::place(char* page, const std::string& record, int slot_no) {
+    PageHeader* header = reinterpret_cast<PageHeader*>(page);
+    Slot* slot = reinterpret_cast<Slot*>(page + PAGE_HEADER_BYTES);
+    if (slot_no == -1) {
+        for (int i = 0; i < header->slot_count && slot_no == -1; i++) {
+            if (slot[i].offset == 0) {
+                slot_no = i;
+            }
+        }
+    }
+    if (slot_no == -1) {
+        slot_no = header->slot_count;
+    }
+    int slot_end = PAGE_HEADER_BYTES + std::max<int>(header->slot_count, slot_no + 1) * SLOT_BYTES;
+    if (header->data_start - slot_end < static_cast<int>(record.size())) {
+        compact_page(page, slot_no);
+    }
+    if (slot_no == header->slot_count) {
+        header->slot_count++;
+    }
+    header->data_start = static_cast<uint16_t>(header->data_start - record.size());
+    std::memcpy(page + header->data_start, record.data(), record.size());
+    slot[slot_no].offset = header->data_start;
+    slot[slot_no].length = static_cast<uint16_t>(record.size());
+    return slot_no;
+}
+
+SlottedStore::RecordSlot SlottedStore::append(const std::string& record) {
+    RecordSlot location;
+    location.page = store_header.last_page;
+    if (location.page != 0) {
+        char* page = pin_page(location.page);
+        // 新槽位要多占SLOT_BYTES；空槽位复用时多算了也无妨
+        if (free_bytes(page) >= static_cast<int>(record.size()) + SLOT_BYTES) {
+            location.slot = place(page, record, -1);
+            unpin_page(location.page, true);
+            return location;
+        }
+        unpin_page(location.page, false);
+    }
+    location.page = store_header.page_count++;
+    store_header.last_page = location.page;
+    write_store_header();
+    char* page = pin_page(location.page, false);
+    std::memset(page, 0, SLOTTED_PAGE_SIZE);
+    reinterpret_cast<PageHeader*>(page)->data_start = SLOTTED_PAGE_SIZE;
+    location.slot = place(page, record, -1);
+    unpin_page(location.page, true);
+    return location;
+}
+
+int SlottedStore::insert(const std::string& record) {
+    RecordSlot location = append(record);
+    int id = ++store_header.record_count;
+    write_store_header();
+    slots.update(location, slot_pos(id));
+    return id;
+}
+
+void SlottedStore::update(int id, const std::string& record) {
+    if (id < 1 || id > store_header.record_count) return;
+    RecordSlot location;
+    slots.read(location, slot_pos(id));
+    char* page = pin_page(location.page);
+    const Slot* slot = reinterpret_cast<const Slot*>(page + PAGE_HEADER_BYTES);
+    if (slot[location.slot].length >= record.size()) {
+        // 不变长时原地改写，多出的字节留到下次整理
+        std::memcpy(page + slot[location.slot].offset, record.data(), record.size());
+        reinterpret_cast<Slot*>(page + PAGE_HEADER_BYTES)[location.slot].length = static_cast<uint16_t>(record.size());
+        unpin_page(location.page, true);
+        return;
+    }
+    if (free_bytes(page, location.slot) >= static_cast<int>(record.size())) {
+        place(page, record, location.slot);
+        unpin_page(location.page, true);
+        return;
+    }
+    // 原页放不下：腾出原槽位，移到最后一页
+    compact_page(page, location.slot);
+    unpin_page(location.page, true);
+    location = append(record);
+    slots.update(location, slot_pos(id));
+}
+
+void SlottedStore::read(int id, std::string& record) {
+    record.clear();
+    if (id < 1 || id > store_header.record_count) return;
+    RecordSlot location;
+    slots.read(location, slot_pos(id));
+    const char* page = pin_page(location.page);
+    const Slot& slot = reinterpret_cast<const Slot*>(page + PAGE_HEADER_BYTES)[location.slot];
+    record.assign(page + slot.offset, slot.length);
+    unpin_page(location.page, false);
+}
+
+void SlottedStore::read_many(const std::vector<int>& ids, std::vector<std::string>& records) {
+    std::vector<long long> positions;
+    positions.reserve(ids.size());
+    for (int id : ids) {
+        positions.push_back(slot_pos(std::max(1, std::min(id, store_header.record_count))));
+    }
+    std::vector<RecordSlot> locations;
+    slots.read_many(positions, locations);
+    records.assign(ids.size(), std::string());
+    for (size_t i = 0; i < ids.size(); i++) {
+        if (ids[i] < 1 || ids[i] > store_header.record_count) continue;
+        const char* page = pin_page(locations[i].page);
+        const Slot& slot = reinterpret_cast<const Slot*>(page + PAGE_HEADER_BYTES)[locations[i].slot];
+        records[i].assign(page + slot.offset, slot.length);
+        unpin_page(locations[i].page, false);
+    }
+}
+
+void SlottedStore::read_page(int page, char* data, int size) {
+    data_file.read(static_cast<long long>(page) * SLOTTED_PAGE_SIZE, data, size);
+}
+
+void SlottedStore::write_page(int page, const char* data, int size) {
+    data_file.write(static_cast<long long>(page) * SLOTTED_PAGE_SIZE, data, size);
+}
+
+void SlottedStore::sync() {
+    data_file.sync();
+}
+
+void SlottedStore::prepare_commit() {
+    pool->collect(this, [this](int page, int begin, const char* data, int size) {
+        journal->record(filename, static_cast<long long>(page) * SLOTTED_PAGE_SIZE + begin, data, size);
+    });
+}
+
+void SlottedStore::committed() {
+    pool->logged(this);
+}
+
+void SlottedStore::checkpoint() {
+    pool->flush(this);
+}
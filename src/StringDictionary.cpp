@@ -0,0 +1,54 @@
+#include "StringDictionary.h"
+#include <cstdio>
+
+static const int DICTIONARY_CACHE_RECORDS = 4096;  // 编号 -> 字符串缓存的容量
+
+StringDictionary::StringDictionary(const std::string& index_name, const std::string& page_name,
+                                   const std::string& slot_name)
+    : ids(index_name), strings(page_name, slot_name), cache(DICTIONARY_CACHE_RECORDS) {}
+
+int StringDictionary::find(const std::string& s) {
+    if (s.empty() || s.size() >= DICTIONARY_STRING_LEN) {
+        return 0;
+    }
+    std::vector<int> found = ids.find(s.c_str());
+    return found.empty() ? 0 : found[0];
+}
+
+int StringDictionary::intern(const std::string& s) {
+    int id = find(s);
+    if (id != 0 || s.empty() || s.size() >= DICTIONARY_STRING_LEN) {
+        return id;
+    }
+    id = strings.insert(s);
+    ids.insert(s.c_str(), id);
+    cache.put(id, s);
+    return id;
+}
+
+std::string StringDictionary::lookup(int id) {
+    std::string s;
+    if (id < 1 || id > strings.size()) {
+        return s;
+    }
+    if (cache.get(id, s)) {
+        return s;
+    }
+    strings.read(id, s);
+    cache.put(id, s);
+    return s;
+}
+
+std::vector<int> StringDictionary::prefix(const std::string& prefix) {
+    std::vector<int> result;
+    for (auto cursor = ids.prefix(prefix.c_str()); cursor.valid(); cursor.next()) {
+        result.push_back(cursor.value());
+    }
+    return result;
+}
+
+std::string StringDictionary::id_key(int id) {
+    char key[DICTIONARY_KEY_LEN];
+    std::snprintf(key, sizeof(key), "%08x", static_cast<unsigned>(id));
+    return key;
+}
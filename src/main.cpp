@@ -3,9 +3,12 @@
 #include <sstream>
 #include <iomanip>
 #include <vector>
+#include <cstdlib>
+#include <unistd.h>
 #include "Account.h"
 #include "Book.h"
 #include "Log.h"
+#include "Journal.h"
 
 using namespace std;
 
@@ -185,6 +188,17 @@ void ProcessBookCommand(BookSystem* bookSystem, const vector<string>& tokens) {
                 author = author.substr(1, author.length() - 2);
                 bookSystem->show("author", author);
             }
+            else if (b_line.find("-name-prefix=") == 0 || b_line.find("-author-prefix=") == 0) {
+                // 按书名或作者前缀查询
+                size_t eq = b_line.find('=');
+                string prefix = b_line.substr(eq + 1);
+                if (prefix.length() < 3) {  // 双引号内不能无内容
+                    cout << "Invalid\n";
+                    return;
+                }
+                prefix = prefix.substr(1, prefix.length() - 2);
+                bookSystem->show(b_line.substr(1, eq - 1), prefix);
+            }
             else if (b_line.find("-keyword=") == 0) {
                 // 按关键词查询
                 string keyword = b_line.substr(9);
@@ -195,6 +209,15 @@ void ProcessBookCommand(BookSystem* bookSystem, const vector<string>& tokens) {
                 keyword = keyword.substr(1, keyword.length() - 2);
                 bookSystem->show("keyword", keyword);
             }
+            else if (b_line.find("-price=") == 0) {
+                // 按价格区间查询：-price=LO..HI
+                string range = b_line.substr(7);
+                if (range.empty()) {
+                    cout << "Invalid\n";
+                    return;
+                }
+                bookSystem->show("price", range);
+            }
             else {
                 cout << "Invalid\n";
             }
@@ -354,10 +377,15 @@ int main() {
     // 设置浮点数输出格式
     cout << fixed << setprecision(2);
 
+    // 重放上次异常退出时已提交但未写回的修改
+    Journal& journal = Journal::shared();
+    journal.recover();
+
     // 初始化系统
     AccountSystem* accountSystem = new AccountSystem();
     LogSystem* financeSystem = new LogSystem(accountSystem);
     BookSystem* bookSystem = new BookSystem(accountSystem, financeSystem);
+    journal.commit();
 
     string line;
 
@@ -398,6 +426,19 @@ int main() {
         else {
             cout << "Invalid\n";
         }
+
+        // 整理工作分摊到各条指令之后，每次只做一小步
+        accountSystem->vacuum();
+        bookSystem->vacuum();
+
+        // 每条指令的全部修改作为一次提交
+        journal.commit();
+    }
+
+    // 测试用：设置了BOOKSTORE_CRASH_ON_EXIT时不做清理直接退出，模拟最后一次提交之后、检查点之前的崩溃
+    if (getenv("BOOKSTORE_CRASH_ON_EXIT") != nullptr) {
+        cout.flush();
+        _exit(0);
     }
 
     // 清理资源
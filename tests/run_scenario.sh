@@ -0,0 +1,18 @@
+#!/bin/sh
+# 用法：run_scenario.sh 程序 场景目录
+# 在一个空的临时目录中按编号顺序运行场景目录下的各次会话（1.in、2.in……），拼接全部输出后与expected.out比较
+# 文件名为N-crash.in的会话在输入结束时不做清理直接退出，模拟最后一次提交之后、检查点之前的崩溃
+set -e
+program=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+scenario=$(cd "$2" && pwd)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+: > output
+for session in $(ls "$scenario" | grep '\.in$' | sort -n); do
+    case "$session" in
+        *-crash.in) BOOKSTORE_CRASH_ON_EXIT=1 "$program" < "$scenario/$session" >> output ;;
+        *) "$program" < "$scenario/$session" >> output ;;
+    esac
+done
+diff -u "$scenario/expected.out" output